@@ -0,0 +1,204 @@
+import sys, os, time, subprocess, shutil, json, statistics
+from mod import log, project, settings, util
+
+# shaders with many programs and big sources, these dominate compile times
+embed_shaders = [
+    'imgui.glsl',
+    'sgl.glsl',
+    'test1.glsl',
+    'sapp/shapes-sapp.glsl',
+    'sapp/shdfeatures-sapp.glsl',
+    'sapp/ozz-skin-sapp.glsl',
+    'sapp/sdf-sapp.glsl',
+]
+embed_modes = ['bytes', 'string', 'embed']
+num_runs = 5
+
+def run_sokol_shdc(fips_dir, proj_dir, cfg_name, args):
+    exit_code = project.run(fips_dir, proj_dir, cfg_name, 'sokol-shdc', args, proj_dir + '/test')
+    if exit_code != 0:
+        log.error(f'sokol-shdc failed with exit code {exit_code}')
+
+def compile_tu(cc, sokol_dir, out_dir, header_path):
+    tu_path = f'{out_dir}/{os.path.basename(header_path)}.c'
+    with open(tu_path, 'w') as f:
+        f.write('#define SOKOL_GLCORE33\n')
+        f.write('#include "sokol_gfx.h"\n')
+        f.write(f'#include "{os.path.abspath(header_path)}"\n')
+    args = [cc, '-std=c2x', '-c', tu_path, '-o', os.devnull, f'-I{sokol_dir}']
+    best = None
+    for _ in range(num_runs):
+        start = time.perf_counter()
+        res = subprocess.run(args, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+        duration = time.perf_counter() - start
+        if res.returncode != 0:
+            return None
+        best = duration if best is None else min(best, duration)
+    return best
+
+def bench_embed(fips_dir, proj_dir, cfg_name, sokol_dir):
+    cc = os.environ.get('CC', 'cc')
+    if not os.path.isfile(f'{sokol_dir}/sokol_gfx.h'):
+        log.error(f"sokol_gfx.h not found in '{sokol_dir}'")
+    out_root = f'{proj_dir}/test/out/bench_embed'
+    if os.path.isdir(out_root):
+        shutil.rmtree(out_root)
+    results = {}
+    for mode in embed_modes:
+        out_dir = f'{out_root}/{mode}'
+        os.makedirs(out_dir)
+        total = 0.0
+        total_size = 0
+        supported = True
+        for shader in embed_shaders:
+            header_path = f'{out_dir}/{os.path.basename(shader)}.h'
+            run_sokol_shdc(fips_dir, proj_dir, cfg_name, [
+                '-i', shader,
+                '-o', header_path,
+                '-l', 'glsl300es:glsl330:hlsl5:metal_macos:metal_ios:metal_sim',
+                '--embed', mode,
+            ])
+            total_size += os.path.getsize(header_path)
+            duration = compile_tu(cc, sokol_dir, out_dir, header_path)
+            if duration is None:
+                supported = False
+                break
+            total += duration
+        results[mode] = (total, total_size) if supported else None
+    log.info(f'==> compile time of consuming TUs ({cc}, best of {num_runs} runs):')
+    for mode in embed_modes:
+        if results[mode] is None:
+            log.info(f'    {mode:8}: not supported by {cc}')
+        else:
+            total, total_size = results[mode]
+            log.info(f'    {mode:8}: {total * 1000.0:8.1f} ms ({total_size / 1024.0:.1f} KB headers)')
+
+def bench_corpus(fips_dir, proj_dir, cfg_name, bench_args):
+    exit_code = project.run(fips_dir, proj_dir, cfg_name, 'shdc-bench', bench_args, proj_dir)
+    if exit_code != 0:
+        log.error(f'shdc-bench failed with exit code {exit_code}')
+
+# write a shader module with many programs, each with its own vertex- and fragment-shader
+def write_synthetic_module(path, num_programs):
+    with open(path, 'w') as f:
+        f.write('@ctype mat4 float[16]\n\n')
+        f.write('@block uniforms\n')
+        f.write('layout(binding=0) uniform params {\n    mat4 mvp;\n    vec4 color;\n};\n')
+        f.write('@end\n\n')
+        for i in range(num_programs):
+            f.write(f'@vs vs_{i}\n@include_block uniforms\n')
+            f.write('in vec4 position;\nin vec2 texcoord0;\nout vec2 uv;\n')
+            f.write(f'void main() {{\n    gl_Position = mvp * (position + vec4({i}.0));\n    uv = texcoord0;\n}}\n@end\n\n')
+            f.write(f'@fs fs_{i}\n@include_block uniforms\n')
+            f.write('layout(binding=0) uniform texture2D tex;\nlayout(binding=0) uniform sampler smp;\n')
+            f.write('in vec2 uv;\nout vec4 frag_color;\n')
+            f.write(f'void main() {{\n    frag_color = texture(sampler2D(tex, smp), uv) * color * {i + 1}.0;\n}}\n@end\n\n')
+            f.write(f'@program prog_{i} vs_{i} fs_{i}\n\n')
+
+def bench_programs(fips_dir, proj_dir, cfg_name, num_programs):
+    out_dir = f'{proj_dir}/test/out/bench_programs'
+    if os.path.isdir(out_dir):
+        shutil.rmtree(out_dir)
+    os.makedirs(out_dir)
+    glsl_path = f'{out_dir}/programs.glsl'
+    trace_path = f'{out_dir}/trace.json'
+    write_synthetic_module(glsl_path, num_programs)
+    run_sokol_shdc(fips_dir, proj_dir, cfg_name, [
+        '-i', glsl_path,
+        '-o', f'{out_dir}/programs.h',
+        '-l', 'glsl330:hlsl5:metal_macos',
+        '--reflection',
+        '--trace', trace_path,
+    ])
+    with open(trace_path, 'r') as f:
+        events = json.load(f)['traceEvents']
+    totals = {}
+    for event in events:
+        totals[event['name']] = totals.get(event['name'], 0) + event['dur']
+    log.info(f'==> sokol-shdc phase times for {num_programs} programs (3 shader languages):')
+    for name in ['load_and_parse', 'compile_glsl', 'translate', 'gather_unique_uniform_blocks', 'generate']:
+        if name in totals:
+            log.info(f'    {name:30}: {totals[name] / 1000.0:10.1f} ms')
+
+trivial_shader = '''@vs vs
+in vec4 position;
+void main() {
+    gl_Position = position;
+}
+@end
+
+@fs fs
+out vec4 frag_color;
+void main() {
+    frag_color = vec4(1.0);
+}
+@end
+
+@program trivial vs fs
+'''
+
+# time-to-first-output of short sokol-shdc runs, which is dominated by process
+# startup when a build invokes sokol-shdc once per shader file
+def bench_startup(fips_dir, proj_dir, cfg_name, runs):
+    out_dir = f'{proj_dir}/test/out/bench_startup'
+    if os.path.isdir(out_dir):
+        shutil.rmtree(out_dir)
+    os.makedirs(out_dir)
+    glsl_path = f'{out_dir}/trivial.glsl'
+    with open(glsl_path, 'w') as f:
+        f.write(trivial_shader)
+    deploy_dir = util.get_deploy_dir(fips_dir, util.get_project_name_from_dir(proj_dir), cfg_name)
+    exe_path = f'{deploy_dir}/sokol-shdc' + ('.exe' if util.get_host_platform() == 'win' else '')
+    if not os.path.isfile(exe_path):
+        log.error(f"sokol-shdc not found at '{exe_path}', build the config first")
+    log.info(f'==> sokol-shdc time-to-first-output for a trivial shader ({runs} runs):')
+    for slang in ['glsl330', 'glsl330:wgsl']:
+        out_path = f'{out_dir}/trivial.glsl.h'
+        args = [exe_path, '-i', glsl_path, '-o', out_path, '-l', slang]
+        durations = []
+        for _ in range(runs):
+            if os.path.isfile(out_path):
+                os.remove(out_path)
+            start = time.perf_counter()
+            res = subprocess.run(args, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+            durations.append(time.perf_counter() - start)
+            if res.returncode != 0 or not os.path.isfile(out_path):
+                log.error(f'sokol-shdc failed: {res.stderr.decode()}')
+        log.info(f'    {slang:14}: min {min(durations) * 1000.0:7.2f} ms, median {statistics.median(durations) * 1000.0:7.2f} ms')
+
+def run(fips_dir, proj_dir, args):
+    if len(args) == 0:
+        help()
+        return
+    bench = args[0]
+    cfg_name = args[1] if len(args) > 1 else None
+    if cfg_name is None:
+        cfg_name = settings.get(proj_dir, 'config')
+    if bench == 'embed':
+        sokol_dir = args[2] if len(args) > 2 else f'{proj_dir}/../sokol'
+        bench_embed(fips_dir, proj_dir, cfg_name, sokol_dir)
+    elif bench == 'programs':
+        num_programs = int(args[2]) if len(args) > 2 else 1000
+        bench_programs(fips_dir, proj_dir, cfg_name, num_programs)
+    elif bench == 'startup':
+        runs = int(args[2]) if len(args) > 2 else 50
+        bench_startup(fips_dir, proj_dir, cfg_name, runs)
+    elif bench == 'corpus':
+        bench_corpus(fips_dir, proj_dir, cfg_name, args[2:])
+    else:
+        log.error(f"unknown benchmark '{bench}'")
+
+def help():
+    log.info(log.YELLOW +
+             'fips bench embed [cfg] [sokol-dir]\n' + log.DEF +
+             '    measure compile time of C code including generated headers for each --embed mode\n' +
+             log.YELLOW +
+             'fips bench programs [cfg] [num-programs]\n' + log.DEF +
+             '    phase times for a synthetic module with many programs (default: 1000)\n' +
+             log.YELLOW +
+             'fips bench startup [cfg] [runs]\n' + log.DEF +
+             '    time-to-first-output for a trivial shader with and without wgsl (default: 50 runs)\n' +
+             log.YELLOW +
+             'fips bench corpus [cfg] [shdc-bench args...]\n' + log.DEF +
+             '    compile the test shader corpus in-process and report per-phase throughput,\n'
+             '    latency percentiles and peak RSS (run with --help for shdc-bench args)')
@@ -1,14 +1,17 @@
-import sys, os
+import sys, os, subprocess, json, glob, shutil
 from mod import log, project, settings
 
 shaders = [
     'chipvis.glsl',
+    'dynamic_attr_index.glsl',
     'fontstash.glsl',
     'imgui.glsl',
+    'include.glsl',
     'infinity.glsl',
     'inout_mismatch.glsl',
     'sgl.glsl',
     'shared_ub.glsl',
+    'specialize.glsl',
     'test1.glsl',
     'test1_pragma.glsl',
     'test_nim.glsl',
@@ -56,6 +59,20 @@ shaders = [
     'sapp/uvwrap-sapp.glsl',
 ]
 
+# lines which must appear in the generated header
+expected_lines = {
+    'dynamic_attr_index.glsl': [
+        '#define ATTR_USED_vs_weights (0xf)',
+    ],
+}
+
+def check_expected_lines(header_path, shader_filename):
+    with open(header_path, 'r') as f:
+        content = f.read()
+    for line in expected_lines.get(shader_filename, []):
+        if line not in content:
+            log.error(f"'{line}' not found in {header_path}")
+
 def run_sokol_shdc(fips_dir, proj_dir, cfg_name, out_path, shader_filename):
     if cfg_name is None:
         cfg_name = settings.get(proj_dir, 'config')
@@ -70,6 +87,97 @@ def run_sokol_shdc(fips_dir, proj_dir, cfg_name, out_path, shader_filename):
     exit_code = project.run(fips_dir, proj_dir, cfg_name, 'sokol-shdc', args, cwd)
     if exit_code != 0:
         sys.exit(exit_code)
+    check_expected_lines(f'{out_path}/{shader_filename}.h', shader_filename)
+
+# compile shaders with command line options which are off by default,
+# outputs are written to a subdirectory named after the test
+option_tests = [
+    ('link_opt', 'inout_mismatch.glsl', ['-l', 'glsl300es:glsl330:hlsl4:metal_macos', '--link-opt']),
+    ('link_opt', 'sapp/shapes-sapp.glsl', ['-l', 'glsl300es:glsl330:hlsl4:metal_macos', '--link-opt']),
+    ('global_bind_slots', 'shared_ub.glsl', ['-l', 'glsl330:hlsl4:metal_macos:wgsl', '--global-bind-slots']),
+    ('global_bind_slots', 'sapp/shdfeatures-sapp.glsl', ['-l', 'glsl330:hlsl4:metal_macos:wgsl', '--global-bind-slots']),
+    ('spirv', 'sapp/texcube-sapp.glsl', ['-l', 'spirv', '-f', 'bare_yaml']),
+    ('spirv', 'shared_ub.glsl', ['-l', 'spirv:glsl330', '-f', 'bare', '--link-opt', '--global-bind-slots']),
+]
+
+def run_option_test(fips_dir, proj_dir, cfg_name, out_path, test_name, shader_filename, extra_args):
+    if cfg_name is None:
+        cfg_name = settings.get(proj_dir, 'config')
+    test_path = f'{out_path}/{test_name}'
+    os.makedirs(os.path.dirname(f'{test_path}/{shader_filename}'), exist_ok=True)
+    args = [
+        '-i', shader_filename,
+        '-o', f'{test_path}/{shader_filename}.h',
+    ] + extra_args
+    log.info(f'==> {shader_filename} ({" ".join(extra_args)}) => {test_path}/{shader_filename}.h:')
+    exit_code = project.run(fips_dir, proj_dir, cfg_name, 'sokol-shdc', args, proj_dir + '/test')
+    if exit_code != 0:
+        sys.exit(exit_code)
+
+# validate the SPIR-V modules written by the spirv option tests
+def validate_spirv(out_path):
+    spirv_val = shutil.which('spirv-val')
+    if spirv_val is None:
+        log.warn('spirv-val not found in PATH, skipping SPIR-V validation')
+        return
+    spv_files = sorted(glob.glob(f'{out_path}/spirv/**/*.spv', recursive=True))
+    if len(spv_files) == 0:
+        log.error(f'no .spv files found in {out_path}/spirv')
+    for spv_file in spv_files:
+        log.info(f'==> spirv-val {spv_file}')
+        res = subprocess.run([spirv_val, '--target-env', 'vulkan1.0', spv_file])
+        if res.returncode != 0:
+            log.error(f'spirv-val failed on {spv_file}')
+
+# specialized programs must have cheaper fragment shaders than the generic
+# program, and shaders only used by specialized programs must not be compiled,
+# checked through the json cost report
+def run_specialize_test(fips_dir, proj_dir, cfg_name, out_path):
+    if cfg_name is None:
+        cfg_name = settings.get(proj_dir, 'config')
+    report_path = f'{out_path}/specialize.report.json'
+    args = [
+        '-i', 'specialize.glsl',
+        '-o', f'{out_path}/specialize.report.glsl.h',
+        '-l', 'glsl330',
+        '--report', report_path,
+        '--report-format', 'json',
+    ]
+    log.info(f'==> specialize.glsl (--report) => {report_path}:')
+    exit_code = project.run(fips_dir, proj_dir, cfg_name, 'sokol-shdc', args, proj_dir + '/test')
+    if exit_code != 0:
+        sys.exit(exit_code)
+    with open(report_path, 'r') as f:
+        report = json.load(f)
+    instrs = { shd['snippet']: shd['instructions'] for shd in report['shaders'] }
+    for name in ['fs', 'fs_lights_1', 'fs_lights_4', 'fs_tint_tint_half']:
+        if name not in instrs:
+            log.error(f"shader '{name}' not found in {report_path}")
+    if 'fs_tint' in instrs:
+        log.error(f"unspecialized shader 'fs_tint' found in {report_path}")
+    if instrs['fs_lights_1'] >= instrs['fs']:
+        log.error(f"fs_lights_1 ({instrs['fs_lights_1']} instructions) is not cheaper than fs ({instrs['fs']} instructions)")
+
+# pack the test directory and compile an @include shader from the pack,
+# running from the output directory so that the files are not found on disk
+def run_pack_test(fips_dir, proj_dir, cfg_name, out_path):
+    if cfg_name is None:
+        cfg_name = settings.get(proj_dir, 'config')
+    pack_path = f'{out_path}/test.pack'
+    log.info(f'==> pack test/ => {pack_path}:')
+    res = subprocess.run([sys.executable, f'{proj_dir}/scripts/shdc-pack.py', '-o', pack_path, '.'], cwd=proj_dir + '/test')
+    if res.returncode != 0:
+        sys.exit(res.returncode)
+    args = [
+        '--pack', pack_path,
+        '-i', 'include.glsl',
+        '-o', f'{out_path}/include.pack.glsl.h',
+        '-l', 'glsl330:hlsl4:metal_macos',
+    ]
+    log.info(f'==> include.glsl (--pack) => {out_path}/include.pack.glsl.h:')
+    exit_code = project.run(fips_dir, proj_dir, cfg_name, 'sokol-shdc', args, out_path)
+    if exit_code != 0:
+        sys.exit(exit_code)
 
 def run(fips_dir, proj_dir, args):
     cfg_name = None
@@ -82,6 +190,11 @@ def run(fips_dir, proj_dir, args):
         os.makedirs(f'{out_path}/sapp')
     for shader in shaders:
         run_sokol_shdc(fips_dir, proj_dir, cfg_name, out_path, shader)
+    for test_name, shader, extra_args in option_tests:
+        run_option_test(fips_dir, proj_dir, cfg_name, out_path, test_name, shader, extra_args)
+    validate_spirv(out_path)
+    run_specialize_test(fips_dir, proj_dir, cfg_name, out_path)
+    run_pack_test(fips_dir, proj_dir, cfg_name, out_path)
 
 def help():
     log.info(log.YELLOW + 'fips run_tests [cfg]\n' + log.DEF + '    run shader compilation tests')
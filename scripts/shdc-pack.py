@@ -0,0 +1,63 @@
+'''
+    Helper script to write a shader source pack file for sokol-shdc --pack.
+
+    Usage: python3 shdc-pack.py -o shaders.pack [--root dir] file_or_dir...
+
+    All .glsl files in the given directories (recursively) and all given
+    files are stored with their path relative to the root directory (default:
+    the current directory), run sokol-shdc with --pack from the root directory
+    and with the same relative input paths.
+
+    NOTE: run with python3
+'''
+import argparse
+import os
+import struct
+import sys
+
+MAGIC = b'SHDCPAK1'
+
+def gather_files(paths, exts):
+    files = []
+    for path in paths:
+        if os.path.isdir(path):
+            for dirpath, _, filenames in os.walk(path):
+                for filename in filenames:
+                    if os.path.splitext(filename)[1] in exts:
+                        files.append(os.path.join(dirpath, filename))
+        else:
+            files.append(path)
+    return sorted(set(files))
+
+def pack_path(path, root):
+    rel = os.path.relpath(path, root)
+    if rel.startswith('..'):
+        # files outside the root directory keep their absolute path
+        rel = os.path.abspath(path)
+    return rel.replace(os.sep, '/')
+
+def write_pack(out_path, files, root):
+    with open(out_path, 'wb') as f:
+        f.write(MAGIC)
+        f.write(struct.pack('<I', len(files)))
+        for path in files:
+            with open(path, 'rb') as src:
+                content = src.read()
+            name = pack_path(path, root).encode('utf-8')
+            f.write(struct.pack('<II', len(name), len(content)))
+            f.write(name)
+            f.write(content)
+
+def main():
+    parser = argparse.ArgumentParser(description='write a shader source pack file for sokol-shdc --pack')
+    parser.add_argument('-o', '--output', required=True, help='output pack file')
+    parser.add_argument('--root', default='.', help='directory the stored paths are relative to')
+    parser.add_argument('--ext', default='.glsl', help='colon-separated file extensions gathered from directories')
+    parser.add_argument('paths', nargs='+', help='shader source files or directories')
+    args = parser.parse_args()
+    files = gather_files(args.paths, args.ext.split(':'))
+    write_pack(args.output, files, args.root)
+    print(f'{args.output}: {len(files)} files', file=sys.stderr)
+
+if __name__ == '__main__':
+    main()
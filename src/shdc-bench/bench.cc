@@ -0,0 +1,334 @@
+/*
+    shdc-bench: in-process compile-time benchmark over the test shader corpus
+
+    Compiles all shaders in test/ and test/sapp for all shader languages N
+    times, and reports per-phase throughput, per-file latency percentiles
+    and peak RSS. Results can be written to a baseline file, and compared
+    against a previous baseline to detect regressions.
+*/
+#include "shdc.h"
+#include "fmt/format.h"
+#include "getopt/getopt.h"
+#include "pystring.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <map>
+
+using namespace shdc;
+
+typedef enum {
+    OPTION_HELP = 1,
+    OPTION_RUNS,
+    OPTION_OUT,
+    OPTION_BASELINE,
+    OPTION_THRESHOLD,
+    OPTION_TMPDIR,
+} bench_option_t;
+
+static const getopt_option_t option_list[] = {
+    { "help",       'h', GETOPT_OPTION_TYPE_NO_ARG,     0, OPTION_HELP,      "print this help text", 0 },
+    { "runs",       'n', GETOPT_OPTION_TYPE_REQUIRED,   0, OPTION_RUNS,      "number of runs over the corpus (default: 5)", "[int]" },
+    { "out",        'o', GETOPT_OPTION_TYPE_REQUIRED,   0, OPTION_OUT,       "write results as baseline file", "[path]" },
+    { "baseline",   'b', GETOPT_OPTION_TYPE_REQUIRED,   0, OPTION_BASELINE,  "compare results against a baseline file", "[path]" },
+    { "threshold",  't', GETOPT_OPTION_TYPE_REQUIRED,   0, OPTION_THRESHOLD, "regression threshold in percent (default: 10)", "[int]" },
+    { "tmpdir",     0,   GETOPT_OPTION_TYPE_REQUIRED,   0, OPTION_TMPDIR,    "directory for generated output (default: system temp dir)", "[dir]" },
+    GETOPT_OPTIONS_END
+};
+
+struct bench_args_t {
+    bool valid = false;
+    int runs = 5;
+    int threshold = 10;
+    std::string test_dir = "test";
+    std::string out;
+    std::string baseline;
+    std::string tmpdir;
+};
+
+struct phase_t {
+    uint64_t total_us = 0;
+    uint64_t count = 0;
+};
+
+struct metric_t {
+    std::string key;
+    double value = 0.0;
+};
+
+static bench_args_t parse_args(int argc, const char** argv) {
+    bench_args_t args;
+    getopt_context_t ctx;
+    if (getopt_create_context(&ctx, argc, argv, option_list) < 0) {
+        fmt::print(stderr, "error in getopt_create_context()\n");
+        return args;
+    }
+    args.valid = true;
+    int opt = 0;
+    while ((opt = getopt_next(&ctx)) != -1) {
+        switch (opt) {
+            case '+':
+                args.test_dir = ctx.current_opt_arg;
+                break;
+            case '?':
+                fmt::print(stderr, "shdc-bench: unknown flag {}\n", ctx.current_opt_arg);
+                args.valid = false;
+                break;
+            case '!':
+                fmt::print(stderr, "shdc-bench: invalid use of flag {}\n", ctx.current_opt_arg);
+                args.valid = false;
+                break;
+            case OPTION_RUNS:
+                args.runs = atoi(ctx.current_opt_arg);
+                break;
+            case OPTION_OUT:
+                args.out = ctx.current_opt_arg;
+                break;
+            case OPTION_BASELINE:
+                args.baseline = ctx.current_opt_arg;
+                break;
+            case OPTION_THRESHOLD:
+                args.threshold = atoi(ctx.current_opt_arg);
+                break;
+            case OPTION_TMPDIR:
+                args.tmpdir = ctx.current_opt_arg;
+                break;
+            case OPTION_HELP:
+            default:
+                {
+                    fmt::print(stderr, "usage: shdc-bench [options] [test-dir]\n\n");
+                    char buf[2048];
+                    fmt::print(stderr, "{}", getopt_create_help_string(&ctx, buf, sizeof(buf)));
+                    args.valid = false;
+                }
+                break;
+        }
+    }
+    if (args.runs < 1) {
+        fmt::print(stderr, "shdc-bench: --runs must be at least 1\n");
+        args.valid = false;
+    }
+    if (args.tmpdir.empty()) {
+        args.tmpdir = std::filesystem::temp_directory_path().string();
+    }
+    return args;
+}
+
+// all *.glsl files in the test directory and its sapp subdirectory, sorted by name
+static std::vector<std::string> find_shaders(const std::string& test_dir) {
+    std::vector<std::string> res;
+    for (const std::string& dir: { test_dir, test_dir + "/sapp" }) {
+        std::error_code ec;
+        for (const auto& entry: std::filesystem::directory_iterator(dir, ec)) {
+            if (entry.is_regular_file() && (entry.path().extension() == ".glsl")) {
+                res.push_back(entry.path().generic_string());
+            }
+        }
+    }
+    std::sort(res.begin(), res.end());
+    return res;
+}
+
+static int num_shader_snippets(const input_t& inp) {
+    int num = 0;
+    for (const snippet_t& snippet: inp.snippets) {
+        if ((snippet.type == snippet_t::VS) || (snippet.type == snippet_t::FS)) {
+            num++;
+        }
+    }
+    return num;
+}
+
+// compile one shader file through the same pipeline as sokol-shdc for all shader
+// languages supported by the C header generator, returns false on error
+static bool compile_shader(const std::string& path, const std::string& out_path) {
+    std::vector<std::string> slangs;
+    for (int i = 0; i < slang_t::NUM; i++) {
+        slang_t::type_t slang = (slang_t::type_t)i;
+        // the C header generator doesn't accept SPIRV, and only one HLSL version
+        if ((slang != slang_t::SPIRV) && (slang != slang_t::HLSL4)) {
+            slangs.push_back(slang_t::to_str(slang));
+        }
+    }
+    const std::string slang_arg = pystring::join(":", slangs);
+    const char* argv[] = { "sokol-shdc", "-i", path.c_str(), "-o", out_path.c_str(), "-l", slang_arg.c_str() };
+    const args_t args = args_t::parse(sizeof(argv) / sizeof(argv[0]), argv);
+    if (!args.valid) {
+        return false;
+    }
+    const compile_result_t res = pipeline_t::compile(args, vfs_t::file_resolver());
+    if (!res.success) {
+        return false;
+    }
+    trace_span_t span("write_output");
+    return !res.output.write_to_files().valid;
+}
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t index = (size_t)(p * (double)(values.size() - 1) + 0.5);
+    return values[std::min(index, values.size() - 1)];
+}
+
+// write metrics as flat JSON object with one key per line
+static bool write_metrics(const std::string& path, const std::vector<metric_t>& metrics) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) {
+        fmt::print(stderr, "shdc-bench: failed to open '{}' for writing\n", path);
+        return false;
+    }
+    fmt::print(f, "{{\n");
+    for (size_t i = 0; i < metrics.size(); i++) {
+        fmt::print(f, "  \"{}\": {:.3f}{}\n", metrics[i].key, metrics[i].value, (i < (metrics.size() - 1)) ? "," : "");
+    }
+    fmt::print(f, "}}\n");
+    fclose(f);
+    return true;
+}
+
+// read a baseline file written by write_metrics()
+static bool read_metrics(const std::string& path, std::map<std::string, double>& out_metrics) {
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) {
+        fmt::print(stderr, "shdc-bench: failed to open baseline file '{}'\n", path);
+        return false;
+    }
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        char key[256];
+        double value = 0.0;
+        if (2 == sscanf(line, " \"%255[^\"]\": %lf", key, &value)) {
+            out_metrics[key] = value;
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+// metrics where a higher value is worse and which are checked for regressions
+static bool is_cost_metric(const std::string& key) {
+    return pystring::endswith(key, "_ms") || (key == "peak_rss_kb");
+}
+
+int main(int argc, const char** argv) {
+    const bench_args_t args = parse_args(argc, argv);
+    if (!args.valid) {
+        return 10;
+    }
+    const std::vector<std::string> shaders = find_shaders(args.test_dir);
+    if (shaders.empty()) {
+        fmt::print(stderr, "shdc-bench: no shaders found in '{}'\n", args.test_dir);
+        return 10;
+    }
+    spirv_t::initialize_spirv_tools();
+    trace_t::enabled = true;
+
+    // gather input sizes and skip shaders which are expected to fail
+    std::vector<std::string> files;
+    uint64_t num_lines = 0;
+    uint64_t num_snippets = 0;
+    const std::string out_path = fmt::format("{}/shdc-bench.h", args.tmpdir);
+    for (const std::string& path: shaders) {
+        const input_t inp = input_t::load_and_parse(path, "", vfs_t::file_resolver());
+        if (!inp.out_error.valid && compile_shader(path, out_path)) {
+            files.push_back(path);
+            num_lines += inp.lines.size();
+            num_snippets += num_shader_snippets(inp);
+        }
+        else {
+            fmt::print("skipping {} (compile error)\n", path);
+        }
+    }
+    trace_t::events.clear();
+
+    // timed runs
+    std::map<std::string, phase_t> phases;
+    std::vector<double> latencies_ms;
+    const auto start = std::chrono::steady_clock::now();
+    for (int run = 0; run < args.runs; run++) {
+        for (const std::string& path: files) {
+            const auto file_start = std::chrono::steady_clock::now();
+            compile_shader(path, out_path);
+            const auto file_end = std::chrono::steady_clock::now();
+            latencies_ms.push_back(std::chrono::duration<double, std::milli>(file_end - file_start).count());
+            for (const trace_t::event_t& event: trace_t::events) {
+                phases[event.name].total_us += event.duration_us;
+                phases[event.name].count++;
+            }
+            trace_t::events.clear();
+        }
+    }
+    const double total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    spirv_t::finalize_spirv_tools();
+
+    // collect metrics, throughput is the corpus size divided by the time spent in a phase
+    const double corpus_lines = (double)(num_lines * args.runs);
+    const double corpus_snippets = (double)(num_snippets * args.runs);
+    std::vector<metric_t> metrics;
+    metrics.push_back({ "runs", (double)args.runs });
+    metrics.push_back({ "files", (double)files.size() });
+    metrics.push_back({ "lines", (double)num_lines });
+    metrics.push_back({ "snippets", (double)num_snippets });
+    metrics.push_back({ "total_ms", total_ms });
+    metrics.push_back({ "lines_per_sec", corpus_lines * 1000.0 / total_ms });
+    metrics.push_back({ "snippets_per_sec", corpus_snippets * 1000.0 / total_ms });
+    metrics.push_back({ "latency.p50_ms", percentile(latencies_ms, 0.5) });
+    metrics.push_back({ "latency.p90_ms", percentile(latencies_ms, 0.9) });
+    metrics.push_back({ "latency.p99_ms", percentile(latencies_ms, 0.99) });
+    metrics.push_back({ "latency.max_ms", percentile(latencies_ms, 1.0) });
+    for (const auto& item: phases) {
+        const double phase_ms = (double)item.second.total_us / 1000.0;
+        metrics.push_back({ fmt::format("phase.{}.total_ms", item.first), phase_ms });
+        metrics.push_back({ fmt::format("phase.{}.lines_per_sec", item.first), (phase_ms > 0.0) ? (corpus_lines * 1000.0 / phase_ms) : 0.0 });
+        metrics.push_back({ fmt::format("phase.{}.snippets_per_sec", item.first), (phase_ms > 0.0) ? (corpus_snippets * 1000.0 / phase_ms) : 0.0 });
+    }
+    metrics.push_back({ "peak_rss_kb", (double)memstats_t::peak_rss_kb() });
+
+    fmt::print("{} files, {} lines, {} snippets, {} slangs, {} runs:\n\n", files.size(), num_lines, num_snippets, (int)slang_t::NUM, args.runs);
+    fmt::print("  {:<36} {:>12} {:>14} {:>14}\n", "phase", "total ms", "lines/s", "snippets/s");
+    for (const auto& item: phases) {
+        const double phase_ms = (double)item.second.total_us / 1000.0;
+        fmt::print("  {:<36} {:>12.1f} {:>14.0f} {:>14.1f}\n", item.first, phase_ms,
+            (phase_ms > 0.0) ? (corpus_lines * 1000.0 / phase_ms) : 0.0,
+            (phase_ms > 0.0) ? (corpus_snippets * 1000.0 / phase_ms) : 0.0);
+    }
+    fmt::print("\n  per-file latency: p50={:.2f}ms p90={:.2f}ms p99={:.2f}ms max={:.2f}ms\n",
+        percentile(latencies_ms, 0.5), percentile(latencies_ms, 0.9), percentile(latencies_ms, 0.99), percentile(latencies_ms, 1.0));
+    fmt::print("  total: {:.1f}ms, peak RSS: {} KB\n", total_ms, memstats_t::peak_rss_kb());
+
+    if (!args.out.empty()) {
+        if (!write_metrics(args.out, metrics)) {
+            return 10;
+        }
+    }
+
+    // compare against baseline, return a non-zero exit code on regressions
+    if (!args.baseline.empty()) {
+        std::map<std::string, double> baseline;
+        if (!read_metrics(args.baseline, baseline)) {
+            return 10;
+        }
+        int num_regressions = 0;
+        for (const metric_t& metric: metrics) {
+            auto it = baseline.find(metric.key);
+            if ((it == baseline.end()) || !is_cost_metric(metric.key) || (it->second <= 0.0)) {
+                continue;
+            }
+            const double change = (metric.value - it->second) * 100.0 / it->second;
+            if (change > (double)args.threshold) {
+                fmt::print("REGRESSION: {}: {:.3f} => {:.3f} ({:+.1f}%)\n", metric.key, it->second, metric.value, change);
+                num_regressions++;
+            }
+        }
+        if (num_regressions > 0) {
+            return 1;
+        }
+        fmt::print("no regressions against baseline '{}' (threshold {}%)\n", args.baseline, args.threshold);
+    }
+    return 0;
+}
@@ -27,6 +27,16 @@ typedef enum {
     OPTION_NOIFDEF,
     OPTION_REFLECTION,
     OPTION_SAVE_INTERMEDIATE_SPIRV,
+    OPTION_EMBED,
+    OPTION_REPORT,
+    OPTION_PACK_UNIFORMS,
+    OPTION_REPORT_FORMAT,
+    OPTION_RELAX_PRECISION,
+    OPTION_LINK_OPT,
+    OPTION_GLOBAL_BIND_SLOTS,
+    OPTION_TRACE,
+    OPTION_MEM_STATS,
+    OPTION_PACK,
 } arg_option_t;
 
 static const getopt_option_t option_list[] = {
@@ -34,11 +44,12 @@ static const getopt_option_t option_list[] = {
     { "input",              'i', GETOPT_OPTION_TYPE_REQUIRED,   0, OPTION_INPUT,        "input source file", "GLSL file" },
     { "output",             'o', GETOPT_OPTION_TYPE_REQUIRED,   0, OPTION_OUTPUT,       "output source file", "C header" },
     { "slang",              'l', GETOPT_OPTION_TYPE_REQUIRED,   0, OPTION_SLANG,        "output shader language(s), see above for list", "glsl330:glsl100..." },
-    { "defines",            0,   GETOPT_OPTION_TYPE_REQUIRED,   0, OPTION_DEFINES,      "optional preprocessor defines", "define1:define2..." },
+    { "defines",            0,   GETOPT_OPTION_TYPE_REQUIRED,   0, OPTION_DEFINES,      "optional preprocessor defines", "define1:define2=value..." },
     { "module",             'm', GETOPT_OPTION_TYPE_REQUIRED,   0, OPTION_MODULE,       "optional @module name override" },
     { "reflection",         'r', GETOPT_OPTION_TYPE_NO_ARG,     0, OPTION_REFLECTION,   "generate runtime reflection functions" },
     { "bytecode",           'b', GETOPT_OPTION_TYPE_NO_ARG,     0, OPTION_BYTECODE,     "output bytecode (HLSL and Metal)"},
     { "format",             'f', GETOPT_OPTION_TYPE_REQUIRED,   0, OPTION_FORMAT,       "output format (default: sokol)", "[sokol|sokol_decl|sokol_impl|sokol_zig|sokol_nim|sokol_odin|sokol_rust|bare|bare_yaml]" },
+    { "embed",              0,   GETOPT_OPTION_TYPE_REQUIRED,   0, OPTION_EMBED,        "how to embed shader code in C headers (default: bytes)", "[bytes|string|embed]" },
     { "errfmt",             'e', GETOPT_OPTION_TYPE_REQUIRED,   0, OPTION_ERRFMT,       "error message format (default: gcc)", "[gcc|msvc]"},
     { "dump",               'd', GETOPT_OPTION_TYPE_NO_ARG,     0, OPTION_DUMP,         "dump debugging information to stderr"},
     { "genver",             'g', GETOPT_OPTION_TYPE_REQUIRED,   0, OPTION_GENVER,       "version-stamp for code-generation", "[int]"},
@@ -46,10 +57,24 @@ static const getopt_option_t option_list[] = {
     { "ifdef",              0,   GETOPT_OPTION_TYPE_NO_ARG,     0, OPTION_IFDEF,        "wrap backend-specific generated code in #ifdef/#endif"},
     { "noifdef",            'n', GETOPT_OPTION_TYPE_NO_ARG,     0, OPTION_NOIFDEF,      "obsolete, superseded by --ifdef"},
     { "save-intermediate-spirv", 0, GETOPT_OPTION_TYPE_NO_ARG,  0, OPTION_SAVE_INTERMEDIATE_SPIRV, "save intermediate SPIRV bytecode (for debug inspection)"},
+    { "pack-uniforms",      0,   GETOPT_OPTION_TYPE_NO_ARG,     0, OPTION_PACK_UNIFORMS, "reorder uniform block members to minimize std140 padding"},
+    { "relax-precision",    0,   GETOPT_OPTION_TYPE_NO_ARG,     0, OPTION_RELAX_PRECISION, "use mediump/half precision in fragment shaders for glsl100, glsl300es and metal_ios/metal_sim"},
+    { "link-opt",           0,   GETOPT_OPTION_TYPE_NO_ARG,     0, OPTION_LINK_OPT,     "remove vertex shader outputs not read by the program's fragment shader"},
+    { "global-bind-slots",  0,   GETOPT_OPTION_TYPE_NO_ARG,     0, OPTION_GLOBAL_BIND_SLOTS, "assign the same bind slot to a resource in all shaders"},
+    { "report",             0,   GETOPT_OPTION_TYPE_REQUIRED,   0, OPTION_REPORT,       "write static shader cost report ('-' for stdout)", "[path]"},
+    { "report-format",      0,   GETOPT_OPTION_TYPE_REQUIRED,   0, OPTION_REPORT_FORMAT, "file format of cost report (default: text)", "[text|json]"},
+    { "trace",              0,   GETOPT_OPTION_TYPE_REQUIRED,   0, OPTION_TRACE,        "write phase timings in Chrome trace-event format", "[path]"},
+    { "mem-stats",          0,   GETOPT_OPTION_TYPE_NO_ARG,     0, OPTION_MEM_STATS,    "print heap allocations and peak memory per compilation phase to stderr"},
+    { "pack",               0,   GETOPT_OPTION_TYPE_REQUIRED,   0, OPTION_PACK,         "load input and @include files from a shader source pack file", "[path]"},
     GETOPT_OPTIONS_END
 };
 
-static void print_help_string(getopt_context_t& ctx) {
+void args_t::print_help() {
+    getopt_context_t ctx;
+    const char* argv[] = { "sokol-shdc" };
+    if (getopt_create_context(&ctx, 1, argv, option_list) < 0) {
+        return;
+    }
     fmt::print(stderr,
         "Shader compiler / code generator for sokol_gfx.h based on GLslang + SPIRV-Cross\n"
         "https://github.com/floooh/sokol-tools\n\n"
@@ -85,7 +110,8 @@ static void print_help_string(getopt_context_t& ctx) {
         "  - metal_macos:   Metal on macOS (SOKOL_METAL)\n"
         "  - metal_ios:     Metal on iOS devices (SOKOL_METAL)\n"
         "  - metal_sim:     Metal on iOS simulator (SOKOL_METAL)\n"
-        "  - wgsl:          WebGPU (SOKOL_WGPU)\n\n"
+        "  - wgsl:          WebGPU (SOKOL_WGPU)\n"
+        "  - spirv:         Vulkan SPIR-V binaries (bare and bare_yaml only)\n\n"
         "Output formats (used with -f --format):\n"
         "  - sokol:         C header which includes both decl and inlined impl\n"
         "  - sokol_decl:    C header with SOKOL_SHDC_DECL wrapped decl and inlined impl\n"
@@ -96,6 +122,10 @@ static void print_help_string(getopt_context_t& ctx) {
         "  - sokol_rust:    Rust module file\n"
         "  - bare:          raw output of SPIRV-Cross compiler, in text or binary format\n"
         "  - bare_yaml:     like bare, but with reflection file in YAML format\n\n"
+        "Embedding modes for C headers (used with --embed):\n"
+        "  - bytes:         hex byte arrays (default, most portable)\n"
+        "  - string:        chunked string literals, faster to compile\n"
+        "  - embed:         C23 #embed of sidecar files next to the output header\n\n"
         "Options:\n\n");
     char buf[4096];
     fmt::print(stderr, "{}", getopt_create_help_string(&ctx, buf, sizeof(buf)));
@@ -116,14 +146,14 @@ static bool parse_slang(args_t& args, const char* str) {
             }
         }
         if (!item_valid) {
-            fmt::print(stderr, "sokol-shdc: unknown shader language '{}'\n", item);
+            args.errors.push_back(fmt::format("unknown shader language '{}'", item));
             args.valid = false;
             args.exit_code = 10;
             return false;
         }
     }
     if ((args.slang & slang_t::bit(slang_t::HLSL4)) && (args.slang & slang_t::bit(slang_t::HLSL5))) {
-        fmt::print(stderr, "sokol-shdc: hlsl4 and hlsl5 output cannot be active at the same time!\n");
+        args.errors.push_back("hlsl4 and hlsl5 output cannot be active at the same time!");
         args.valid = false;
         args.exit_code = 10;
         return false;
@@ -134,15 +164,36 @@ static bool parse_slang(args_t& args, const char* str) {
 static void validate(args_t& args) {
     bool err = false;
     if (args.input.empty()) {
-        fmt::print(stderr, "sokol-shdc: no input file (--input [path])\n");
+        args.errors.push_back("no input file (--input [path])");
         err = true;
     }
     if (args.output.empty()) {
-        fmt::print(stderr, "sokol-shdc: no output file (--output [path])\n");
+        args.errors.push_back("no output file (--output [path])");
         err = true;
     }
     if (args.slang == 0) {
-        fmt::print(stderr, "sokol-shdc: no shader languages (--slang ...)\n");
+        args.errors.push_back("no shader languages (--slang ...)");
+        err = true;
+    }
+    for (const std::string& define: args.defines) {
+        if (!util::is_valid_define(define)) {
+            args.errors.push_back(fmt::format("invalid define '{}' (must be NAME or NAME=VALUE)", define));
+            err = true;
+        }
+    }
+    if ((args.embed != embed_t::BYTES) &&
+        (args.output_format != format_t::SOKOL) &&
+        (args.output_format != format_t::SOKOL_DECL) &&
+        (args.output_format != format_t::SOKOL_IMPL))
+    {
+        args.errors.push_back(fmt::format("--embed={} is only supported for the sokol, sokol_decl and sokol_impl output formats", embed_t::to_str(args.embed)));
+        err = true;
+    }
+    if ((args.slang & slang_t::bit(slang_t::SPIRV)) &&
+        (args.output_format != format_t::BARE) &&
+        (args.output_format != format_t::BARE_YAML))
+    {
+        args.errors.push_back("spirv output is only supported for the bare and bare_yaml output formats");
         err = true;
     }
     if (args.tmpdir.empty()) {
@@ -179,22 +230,22 @@ args_t args_t::parse(int argc, const char** argv) {
 
     getopt_context_t ctx;
     if (getopt_create_context(&ctx, argc, argv, option_list) < 0) {
-        fmt::print(stderr, "error in getopt_create_context()\n");
+        args.errors.push_back("error in getopt_create_context()");
     }
     else {
         int opt = 0;
         while ((opt = getopt_next(&ctx)) != -1) {
             switch (opt) {
                 case '+':
-                    fmt::print(stderr, "sokol-shdc: got argument without flag: {}\n", ctx.current_opt_arg);
+                    args.errors.push_back(fmt::format("got argument without flag: {}", ctx.current_opt_arg));
                     args.valid = false;
                     return args;
                 case '?':
-                    fmt::print(stderr, "sokol-shdc: unknown flag {}\n", ctx.current_opt_arg);
+                    args.errors.push_back(fmt::format("unknown flag {}", ctx.current_opt_arg));
                     args.valid = false;
                     return args;
                 case '!':
-                    fmt::print(stderr, "sokol-shdc: invalid use of flag {}\n", ctx.current_opt_arg);
+                    args.errors.push_back(fmt::format("invalid use of flag {}", ctx.current_opt_arg));
                     args.valid = false;
                     return args;
                 case OPTION_INPUT:
@@ -221,7 +272,49 @@ args_t args_t::parse(int argc, const char** argv) {
                 case OPTION_FORMAT:
                     args.output_format = format_t::from_str(ctx.current_opt_arg);
                     if (args.output_format == format_t::INVALID) {
-                        fmt::print(stderr, "sokol-shdc: unknown output format {}, must be [sokol|sokol_decl|sokol_impl|sokol_zig|sokol_nim|sokol_odin|bare]\n", ctx.current_opt_arg);
+                        args.errors.push_back(fmt::format("unknown output format {}, must be [sokol|sokol_decl|sokol_impl|sokol_zig|sokol_nim|sokol_odin|bare]", ctx.current_opt_arg));
+                        args.valid = false;
+                        args.exit_code = 10;
+                        return args;
+                    }
+                    break;
+                case OPTION_EMBED:
+                    args.embed = embed_t::from_str(ctx.current_opt_arg);
+                    if (args.embed == embed_t::INVALID) {
+                        args.errors.push_back(fmt::format("unknown embed mode {}, must be [bytes|string|embed]", ctx.current_opt_arg));
+                        args.valid = false;
+                        args.exit_code = 10;
+                        return args;
+                    }
+                    break;
+                case OPTION_PACK_UNIFORMS:
+                    args.pack_uniforms = true;
+                    break;
+                case OPTION_RELAX_PRECISION:
+                    args.relax_precision = true;
+                    break;
+                case OPTION_LINK_OPT:
+                    args.link_opt = true;
+                    break;
+                case OPTION_GLOBAL_BIND_SLOTS:
+                    args.global_bind_slots = true;
+                    break;
+                case OPTION_REPORT:
+                    args.report = ctx.current_opt_arg;
+                    break;
+                case OPTION_TRACE:
+                    args.trace = ctx.current_opt_arg;
+                    break;
+                case OPTION_MEM_STATS:
+                    args.mem_stats = true;
+                    break;
+                case OPTION_PACK:
+                    args.pack = ctx.current_opt_arg;
+                    break;
+                case OPTION_REPORT_FORMAT:
+                    args.report_format = report_format_t::from_str(ctx.current_opt_arg);
+                    if (args.report_format == report_format_t::INVALID) {
+                        args.errors.push_back(fmt::format("unknown report format {}, must be [text|json]", ctx.current_opt_arg));
                         args.valid = false;
                         args.exit_code = 10;
                         return args;
@@ -247,7 +340,7 @@ args_t args_t::parse(int argc, const char** argv) {
                         args.error_format = errmsg_t::MSVC;
                     }
                     else {
-                        fmt::print(stderr, "sokol-shdc: unknown error format {}, must be 'gcc' or 'msvc'\n", ctx.current_opt_arg);
+                        args.errors.push_back(fmt::format("unknown error format {}, must be 'gcc' or 'msvc'", ctx.current_opt_arg));
                         args.valid = false;
                         args.exit_code = 10;
                         return args;
@@ -264,7 +357,7 @@ args_t args_t::parse(int argc, const char** argv) {
                     args.ifdef = false;
                     break;
                 case OPTION_HELP:
-                    print_help_string(ctx);
+                    args.help = true;
                     args.valid = false;
                     args.exit_code = 0;
                     return args;
@@ -289,6 +382,16 @@ void args_t::dump_debug() const {
     fmt::print(stderr, "  module: '{}'\n", module);
     fmt::print(stderr, "  defines: '{}'\n", pystring::join(":", defines));
     fmt::print(stderr, "  output_format: '{}'\n", format_t::to_str(output_format));
+    fmt::print(stderr, "  embed: '{}'\n", embed_t::to_str(embed));
+    fmt::print(stderr, "  pack_uniforms: {}\n", pack_uniforms);
+    fmt::print(stderr, "  relax_precision: {}\n", relax_precision);
+    fmt::print(stderr, "  link_opt: {}\n", link_opt);
+    fmt::print(stderr, "  global_bind_slots: {}\n", global_bind_slots);
+    fmt::print(stderr, "  report: '{}'\n", report);
+    fmt::print(stderr, "  report_format: '{}'\n", report_format_t::to_str(report_format));
+    fmt::print(stderr, "  trace: '{}'\n", trace);
+    fmt::print(stderr, "  mem_stats: {}\n", mem_stats);
+    fmt::print(stderr, "  pack: '{}'\n", pack);
     fmt::print(stderr, "  debug_dump: {}\n", debug_dump);
     fmt::print(stderr, "  ifdef: {}\n", ifdef);
     fmt::print(stderr, "  gen_version: {}\n", gen_version);
@@ -25,44 +25,37 @@ const char* bare_t::slang_file_extension(slang_t::type_t c, bool binary) {
             return binary ? ".metallib" : ".metal";
         case slang_t::WGSL:
             return ".wgsl";
+        case slang_t::SPIRV:
+            return ".spv";
         default:
             return "";
     }
 }
 
-static errmsg_t write_stage(const std::string& file_path,
-                            const spirvcross_source_t* src,
-                            const bytecode_blob_t* blob)
+static void write_stage(const std::string& file_path,
+                        const spirvcross_source_t* src,
+                        const bytecode_blob_t* blob,
+                        output_t& out)
 {
-    // write text or binary to output file
-    FILE* f = fopen(file_path.c_str(), "wb");
-    if (!f) {
-        return errmsg_t::error(file_path, 0, fmt::format("failed to open output file '{}'", file_path));
-    }
-    const void* write_data;
-    size_t write_count;
+    // add text or binary to output files
     if (blob) {
-        write_data = blob->data.data();
-        write_count = blob->data.size();
+        out.add(file_path, std::string(blob->data.begin(), blob->data.end()));
+    }
+    else if (!src->spirv.empty()) {
+        out.add(file_path, std::string((const char*)src->spirv.data(), src->spirv.size() * sizeof(uint32_t)));
     }
     else {
         assert(src);
-        write_data = src->source_code.data();
-        write_count = src->source_code.length();
-    }
-    size_t written = fwrite(write_data, 1, write_count, f);
-    if (written != write_count) {
-        return errmsg_t::error(file_path, 0, fmt::format("failed to write output file '{}'", file_path));
+        out.add(file_path, src->source_code);
     }
-    fclose(f);
-    return errmsg_t();
 }
 
-static errmsg_t write_shader_sources_and_blobs(const args_t& args,
-                                               const input_t& inp,
-                                               const spirvcross_t& spirvcross,
-                                               const bytecode_t& bytecode,
-                                               slang_t::type_t slang)
+static void write_shader_sources_and_blobs(const args_t& args,
+                                           const input_t& inp,
+                                           const spirvcross_t& spirvcross,
+                                           const bytecode_t& bytecode,
+                                           slang_t::type_t slang,
+                                           output_t& out)
 {
     for (const auto& item: inp.programs) {
         const program_t& prog = item.second;
@@ -72,26 +65,18 @@ static errmsg_t write_shader_sources_and_blobs(const args_t& args,
         const bytecode_blob_t* fs_blob = find_bytecode_blob_by_shader_name(prog.fs_name, inp, bytecode);
 
         const std::string file_path_base = fmt::format("{}_{}{}_{}", args.output, mod_prefix(inp), prog.name, slang_t::to_str(slang));
-        const std::string file_path_vs = fmt::format("{}_vs{}", file_path_base, bare_t::slang_file_extension(slang, vs_blob));
-        const std::string file_path_fs = fmt::format("{}_fs{}", file_path_base, bare_t::slang_file_extension(slang, fs_blob));
+        const std::string file_path_vs = fmt::format("{}_vs{}", file_path_base, bare_t::slang_file_extension(slang, vs_blob || !vs_src->spirv.empty()));
+        const std::string file_path_fs = fmt::format("{}_fs{}", file_path_base, bare_t::slang_file_extension(slang, fs_blob || !fs_src->spirv.empty()));
 
-        errmsg_t err;
-        err = write_stage(file_path_vs, vs_src, vs_blob);
-        if (err.valid) {
-            return err;
-        }
-        err = write_stage(file_path_fs, fs_src, fs_blob);
-        if (err.valid) {
-            return err;
-        }
+        write_stage(file_path_vs, vs_src, vs_blob, out);
+        write_stage(file_path_fs, fs_src, fs_blob, out);
     }
-
-    return errmsg_t();
 }
 
 errmsg_t bare_t::gen(const args_t& args, const input_t& inp,
                      const std::array<spirvcross_t,slang_t::NUM>& spirvcross,
-                     const std::array<bytecode_t,slang_t::NUM>& bytecode)
+                     const std::array<bytecode_t,slang_t::NUM>& bytecode,
+                     output_t& out)
 {
     for (int i = 0; i < slang_t::NUM; i++) {
         slang_t::type_t slang = (slang_t::type_t) i;
@@ -100,10 +85,7 @@ errmsg_t bare_t::gen(const args_t& args, const input_t& inp,
             if (err.valid) {
                 return err;
             }
-            err = write_shader_sources_and_blobs(args, inp, spirvcross[i], bytecode[i], slang);
-            if (err.valid) {
-                return err;
-            }
+            write_shader_sources_and_blobs(args, inp, spirvcross[i], bytecode[i], slang, out);
         }
     }
 
@@ -13,6 +13,7 @@
 #include "fmt/format.h"
 #include "pystring.h"
 #include <stdio.h> // popen etc...
+#include <assert.h>
 #if defined(_WIN32)
 #include <d3dcompiler.h>
 #include <d3dcommon.h>
@@ -20,11 +21,18 @@
 
 namespace shdc {
 
+void bytecode_t::add_blob(bytecode_blob_t&& blob) {
+    assert(blob.snippet_index >= 0);
+    if (blob.snippet_index >= (int)blob_index_by_snippet.size()) {
+        blob_index_by_snippet.resize(blob.snippet_index + 1, -1);
+    }
+    blob_index_by_snippet[blob.snippet_index] = (int)blobs.size();
+    blobs.push_back(std::move(blob));
+}
+
 int bytecode_t::find_blob_by_snippet_index(int snippet_index) const {
-    for (int i = 0; i < (int)blobs.size(); i++) {
-        if (blobs[i].snippet_index == snippet_index) {
-            return i;
-        }
+    if ((snippet_index >= 0) && (snippet_index < (int)blob_index_by_snippet.size())) {
+        return blob_index_by_snippet[snippet_index];
     }
     return -1;
 }
@@ -217,7 +225,7 @@ static bytecode_t mtl_compile(const args_t& args, const input_t& inp, const spir
         blob.valid = true;
         blob.snippet_index = src.snippet_index;
         blob.data = std::move(data);
-        bytecode.blobs.push_back(std::move(blob));
+        bytecode.add_blob(std::move(blob));
     }
     return bytecode;
 }
@@ -338,7 +346,7 @@ static bytecode_t d3d_compile(const input_t& inp, const spirvcross_t& spirvcross
             blob.valid = true;
             blob.snippet_index = src.snippet_index;
             blob.data = std::move(data);
-            bytecode.blobs.push_back(std::move(blob));
+            bytecode.add_blob(std::move(blob));
         }
         if (errors) {
             errors->Release();
@@ -9,22 +9,6 @@
 
 namespace shdc {
 
-static std::string load_file_into_str(const std::string& path) {
-    FILE* f = fopen(path.c_str(), "rb");
-    if (!f) {
-        return std::string();
-    }
-    fseek(f, 0, SEEK_END);
-    const size_t file_size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    char* buf = (char*) malloc(file_size + 1);
-    fread((void*)buf, file_size, 1, f);
-    buf[file_size] = 0;
-    std::string str(buf);
-    free((void*)buf);
-    return str;
-}
-
 /* removes comments from string
     - FIXME: doesn't detect block-comment in block-comment bugs
     - also removes comments in string literals (no problem for shader langs)
@@ -265,8 +249,8 @@ static bool validate_end_tag(const std::vector<std::string>& tokens, bool in_sni
 }
 
 static bool validate_program_tag(const std::vector<std::string>& tokens, bool in_snippet, int line_index, input_t& inp) {
-    if (tokens.size() != 4) {
-        inp.out_error = inp.error(line_index, "@program tag must have exactly 3 args (@program name vs_name fs_name).");
+    if (tokens.size() < 4) {
+        inp.out_error = inp.error(line_index, "@program tag must have at least 3 args (@program name vs_name fs_name [NAME=VALUE...]).");
         return false;
     }
     if (in_snippet) {
@@ -285,21 +269,62 @@ static bool validate_program_tag(const std::vector<std::string>& tokens, bool in
         inp.out_error = inp.error(line_index, fmt::format("@fs '{}' not found for @program '{}'.", tokens[3], tokens[1]));
         return false;
     }
+    for (int i = 4; i < (int)tokens.size(); i++) {
+        if (!util::is_valid_define(tokens[i])) {
+            inp.out_error = inp.error(line_index, fmt::format("invalid define '{}' in @program '{}' (must be NAME or NAME=VALUE).", tokens[i], tokens[1]));
+            return false;
+        }
+    }
+    return true;
+}
+
+/* a @program with defines gets its own specialized copies of the vertex-
+    and fragment-shader snippets, named [snippet]_[program], so that each
+    specialization is compiled and optimized separately
+*/
+static bool specialize_program(program_t& prog, input_t& inp) {
+    for (int i = 0; i < 2; i++) {
+        const bool is_vs = (i == 0);
+        std::map<std::string, int>& map = is_vs ? inp.vs_map : inp.fs_map;
+        std::string& snippet_name = is_vs ? prog.vs_name : prog.fs_name;
+        const std::string clone_name = fmt::format("{}_{}", snippet_name, prog.name);
+        if (inp.snippet_map.count(clone_name) > 0) {
+            inp.out_error = inp.error(prog.line_index, fmt::format("specialized shader name '{}' of @program '{}' already defined.", clone_name, prog.name));
+            return false;
+        }
+        snippet_t& base = inp.snippets[map[snippet_name]];
+        snippet_t clone = base;
+        clone.name = clone_name;
+        clone.defines = prog.defines;
+        clone.specialized_only = false;
+        // cleared again in parse() if an unspecialized program uses the base snippet
+        base.specialized_only = true;
+        const int clone_index = (int)inp.snippets.size();
+        inp.snippet_map[clone_name] = clone_index;
+        map[clone_name] = clone_index;
+        inp.snippets.push_back(std::move(clone));
+        snippet_name = clone_name;
+    }
     return true;
 }
 
 static bool validate_options_tag(const std::vector<std::string>& tokens, const snippet_t& cur_snippet, int line_index, input_t& inp) {
     if (tokens.size() < 2) {
-        inp.out_error = inp.error(line_index, fmt::format("{} must have at least 1 arg ('fixup_clipspace', 'flip_vert_y')", tokens[0]));
+        inp.out_error = inp.error(line_index, fmt::format("{} must have at least 1 arg ('fixup_clipspace', 'flip_vert_y', 'relax_precision', 'full_precision')", tokens[0]));
         return false;
     }
-    if (cur_snippet.type != snippet_t::VS) {
-        inp.out_error = inp.error(line_index, fmt::format("{} must be inside a @vs block", tokens[0]));
+    if ((cur_snippet.type != snippet_t::VS) && (cur_snippet.type != snippet_t::FS)) {
+        inp.out_error = inp.error(line_index, fmt::format("{} must be inside a @vs or @fs block", tokens[0]));
         return false;
     }
     for (int i = 1; i < (int)tokens.size(); i++) {
-        if (option_t::from_string(tokens[i]) == option_t::INVALID) {
-            inp.out_error = inp.error(line_index, fmt::format("unknown option '{}' (must be 'fixup_clipspace', 'flip_vert_y')", tokens[i]));
+        const option_t::type_t option = option_t::from_string(tokens[i]);
+        if (option == option_t::INVALID) {
+            inp.out_error = inp.error(line_index, fmt::format("unknown option '{}' (must be 'fixup_clipspace', 'flip_vert_y', 'relax_precision', 'full_precision')", tokens[i]));
+            return false;
+        }
+        if (((option == option_t::FIXUP_CLIPSPACE) || (option == option_t::FLIP_VERT_Y)) && (cur_snippet.type != snippet_t::VS)) {
+            inp.out_error = inp.error(line_index, fmt::format("option '{}' must be inside a @vs block", tokens[i]));
             return false;
         }
     }
@@ -441,7 +466,12 @@ static bool parse(input_t& inp) {
                 if (!validate_program_tag(tokens, in_snippet, line_index, inp)) {
                     return false;
                 }
-                inp.programs[tokens[1]] = program_t(tokens[1], tokens[2], tokens[3], line_index);
+                program_t prog(tokens[1], tokens[2], tokens[3], line_index);
+                prog.defines.assign(tokens.begin() + 4, tokens.end());
+                if (!prog.defines.empty() && !specialize_program(prog, inp)) {
+                    return false;
+                }
+                inp.programs[tokens[1]] = prog;
                 add_line = false;
             }
             else if (tokens[0][0] == '@') {
@@ -458,6 +488,11 @@ static bool parse(input_t& inp) {
         inp.out_error = inp.error(line_index - 1, "final @end missing.");
         return false;
     }
+    // base snippets of specialized programs are only compiled when used directly
+    for (const auto& item: inp.programs) {
+        inp.snippets[inp.vs_map[item.second.vs_name]].specialized_only = false;
+        inp.snippets[inp.fs_map[item.second.fs_name]].specialized_only = false;
+    }
     return true;
 }
 
@@ -470,20 +505,22 @@ static bool validate_include_tag(const std::vector<std::string>& tokens, int lin
 }
 
 static bool load_and_preprocess(const std::string& path, const std::vector<std::string>& include_dirs,
-                                input_t& inp, int parent_line_index) {
+                                const include_resolver_t& resolver, input_t& inp, int parent_line_index) {
+    trace_span_t span("load_file", {{ "file", path }});
     std::string path_used = path;
-    std::string str = load_file_into_str(path_used);
-    if (str.empty()) {
+    std::string str;
+    bool loaded = resolver(path_used, str);
+    if (!loaded) {
         // check include directories
         for (const std::string& include_dir : include_dirs) {
             path_used = pystring::os::path::join(include_dir, path);
-            str = load_file_into_str(path_used);
-            if (!str.empty()) {
+            loaded = resolver(path_used, str);
+            if (loaded) {
                 break;
             }
         }
         // failure?
-        if (str.empty()) {
+        if (!loaded) {
             if (inp.base_path == path) {
                 inp.out_error = errmsg_t::error(path, 0, fmt::format("Failed to open input file '{}'", path));
             }
@@ -529,7 +566,7 @@ static bool load_and_preprocess(const std::string& path, const std::vector<std::
                 }
                 // insert included file
                 const std::string& include_filename = tokens[1];
-                if (!load_and_preprocess(include_filename, include_dirs, inp, line_index)) {
+                if (!load_and_preprocess(include_filename, include_dirs, resolver, inp, line_index)) {
                     return false;
                 }
             }
@@ -549,10 +586,10 @@ static bool load_and_preprocess(const std::string& path, const std::vector<std::
     return true;
 }
 
-/* load file and parse into an input_t object,
+/* load file through the include resolver and parse into an input_t object,
    check valid and error fields in returned object
 */
-input_t input_t::load_and_parse(const std::string& path, const std::string& module_override) {
+input_t input_t::load_and_parse(const std::string& path, const std::string& module_override, const include_resolver_t& resolver) {
     std::string dir;
     std::string filename;
     pystring::os::path::split(dir, filename, path);
@@ -560,7 +597,8 @@ input_t input_t::load_and_parse(const std::string& path, const std::string& modu
 
     input_t inp;
     inp.base_path = path;
-    if (load_and_preprocess(path, include_dirs, inp, 0)) {
+    if (load_and_preprocess(path, include_dirs, resolver, inp, 0)) {
+        trace_span_t span("parse_input");
         parse(inp);
     }
     if (!module_override.empty()) {
@@ -602,6 +640,8 @@ void input_t::dump_debug(errmsg_t::msg_format_t err_fmt) const {
             fmt::print(stderr, "    snippet {}:\n", snippet_nr++);
             fmt::print(stderr, "      name: {}\n", snippet.name);
             fmt::print(stderr, "      type: {}\n", snippet_t::type_to_str(snippet.type));
+            fmt::print(stderr, "      defines: '{}'\n", pystring::join(":", snippet.defines));
+            fmt::print(stderr, "      specialized_only: {}\n", snippet.specialized_only);
             fmt::print(stderr, "      lines:\n");
             int line_nr = 1;
             for (int line_index : snippet.lines) {
@@ -633,6 +673,7 @@ void input_t::dump_debug(errmsg_t::msg_format_t err_fmt) const {
         fmt::print(stderr, "      name: {}\n", prog.name);
         fmt::print(stderr, "      vs: {}\n", prog.vs_name);
         fmt::print(stderr, "      fs: {}\n", prog.fs_name);
+        fmt::print(stderr, "      defines: '{}'\n", pystring::join(":", prog.defines));
         fmt::print(stderr, "      line_index: {}\n", prog.line_index);
     }
     fmt::print("\n");
@@ -2,134 +2,204 @@
     sokol-shdc main source file.
 */
 #include "shdc.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <new>
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
 
 using namespace shdc;
 
-int main(int argc, const char** argv) {
-    spirv_t::initialize_spirv_tools();
+// counting global allocation functions for --mem-stats, each allocation is
+// prefixed with a header which stores the requested size, so that frees can
+// be subtracted from the live heap size; without --mem-stats the header is
+// marked as not counted and the counters are left alone
+static const size_t alloc_header_size = alignof(std::max_align_t);
+static const size_t alloc_not_counted = SIZE_MAX;
+
+// only over-aligned allocations need an aligned allocation function
+static void* alloc_base(size_t size, size_t align) {
+    if (align <= alloc_header_size) {
+        return malloc(size);
+    }
+    #if defined(_WIN32)
+    return _aligned_malloc(size, align);
+    #else
+    void* ptr = nullptr;
+    return (0 == posix_memalign(&ptr, align, size)) ? ptr : nullptr;
+    #endif
+}
+
+static void free_base(void* ptr, size_t align) {
+    #if defined(_WIN32)
+    if (align > alloc_header_size) {
+        _aligned_free(ptr);
+        return;
+    }
+    #endif
+    free(ptr);
+}
+
+// header_size is also the alignment of the returned pointer
+static void* counted_alloc(size_t size, size_t header_size) {
+    uint8_t* ptr = (uint8_t*) alloc_base(size + header_size, header_size);
+    if (!ptr) {
+        return nullptr;
+    }
+    if (memstats_t::enabled) {
+        *(size_t*)ptr = size;
+        memstats_t::on_alloc(size);
+    }
+    else {
+        *(size_t*)ptr = alloc_not_counted;
+    }
+    return ptr + header_size;
+}
+
+static void counted_free(void* ptr, size_t header_size) {
+    if (ptr) {
+        uint8_t* base = ((uint8_t*)ptr) - header_size;
+        const size_t size = *(size_t*)base;
+        if (size != alloc_not_counted) {
+            memstats_t::on_free(size);
+        }
+        free_base(base, header_size);
+    }
+}
+
+static size_t aligned_header_size(std::align_val_t align) {
+    return std::max((size_t)align, alloc_header_size);
+}
+
+void* operator new(size_t size) {
+    void* ptr = counted_alloc(size, alloc_header_size);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return counted_alloc(size, alloc_header_size);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return counted_alloc(size, alloc_header_size);
+}
+void* operator new(size_t size, std::align_val_t align) {
+    void* ptr = counted_alloc(size, aligned_header_size(align));
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+void* operator new[](size_t size, std::align_val_t align) {
+    return operator new(size, align);
+}
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return counted_alloc(size, aligned_header_size(align));
+}
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return counted_alloc(size, aligned_header_size(align));
+}
+void operator delete(void* ptr) noexcept {
+    counted_free(ptr, alloc_header_size);
+}
+void operator delete[](void* ptr) noexcept {
+    counted_free(ptr, alloc_header_size);
+}
+void operator delete(void* ptr, size_t) noexcept {
+    counted_free(ptr, alloc_header_size);
+}
+void operator delete[](void* ptr, size_t) noexcept {
+    counted_free(ptr, alloc_header_size);
+}
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    counted_free(ptr, alloc_header_size);
+}
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    counted_free(ptr, alloc_header_size);
+}
+void operator delete(void* ptr, std::align_val_t align) noexcept {
+    counted_free(ptr, aligned_header_size(align));
+}
+void operator delete[](void* ptr, std::align_val_t align) noexcept {
+    counted_free(ptr, aligned_header_size(align));
+}
+void operator delete(void* ptr, size_t, std::align_val_t align) noexcept {
+    counted_free(ptr, aligned_header_size(align));
+}
+void operator delete[](void* ptr, size_t, std::align_val_t align) noexcept {
+    counted_free(ptr, aligned_header_size(align));
+}
+void operator delete(void* ptr, std::align_val_t align, const std::nothrow_t&) noexcept {
+    counted_free(ptr, aligned_header_size(align));
+}
+void operator delete[](void* ptr, std::align_val_t align, const std::nothrow_t&) noexcept {
+    counted_free(ptr, aligned_header_size(align));
+}
 
+int main(int argc, const char** argv) {
     // parse command line args
     args_t args = args_t::parse(argc, argv);
     if (args.debug_dump) {
         args.dump_debug();
     }
+    if (args.help) {
+        args_t::print_help();
+    }
+    for (const std::string& err: args.errors) {
+        fmt::print(stderr, "sokol-shdc: {}\n", err);
+    }
     if (!args.valid) {
         return args.exit_code;
     }
+    trace_t::enabled = !args.trace.empty();
+    memstats_t::enabled = args.mem_stats;
 
-    // load the source and parse tagged blocks
-    input_t inp = input_t::load_and_parse(args.input, args.module);
-    if (args.debug_dump) {
-        inp.dump_debug(args.error_format);
-    }
-    if (inp.out_error.valid) {
-        inp.out_error.print(args.error_format);
-        return 10;
+    // input files are loaded from the filesystem, or from a shader source pack
+    include_resolver_t resolver = vfs_t::file_resolver();
+    if (!args.pack.empty()) {
+        errmsg_t pack_err = vfs_t::pack_resolver(args.pack, resolver);
+        if (pack_err.valid) {
+            pack_err.print(args.error_format);
+            return 10;
+        }
     }
 
-    // compile source snippets to SPIRV blobs
-    std::array<spirv_t,slang_t::NUM> spirv;
-    for (int i = 0; i < slang_t::NUM; i++) {
-        slang_t::type_t slang = (slang_t::type_t)i;
-        if (args.slang & slang_t::bit(slang)) {
-            spirv[i] = spirv_t::compile_glsl(inp, slang, args.defines);
-            if (args.debug_dump) {
-                spirv[i].dump_debug(inp, args.error_format);
-            }
-            if (!spirv[i].errors.empty()) {
-                bool has_errors = false;
-                for (const errmsg_t& err: spirv[i].errors) {
-                    if (err.type == errmsg_t::ERROR) {
-                        has_errors = true;
-                    }
-                    err.print(args.error_format);
-                }
-                if (has_errors) {
-                    return 10;
-                }
-            }
-            if (args.save_intermediate_spirv) {
-                if (!spirv[i].write_to_file(args, inp, slang)) {
-                    return 10;
-                }
-            }
-        }
+    // run the compilation pipeline on the input file
+    const compile_result_t res = pipeline_t::compile(args, resolver);
+    for (const errmsg_t& err: res.diagnostics) {
+        err.print(args.error_format);
+    }
+    if (!res.success) {
+        return 10;
     }
 
-    // cross-translate SPIRV to shader dialects
-    std::array<spirvcross_t,slang_t::NUM> spirvcross;
-    for (int i = 0; i < slang_t::NUM; i++) {
-        slang_t::type_t slang = (slang_t::type_t)i;
-        if (args.slang & slang_t::bit(slang)) {
-            spirvcross[i] = spirvcross_t::translate(inp, spirv[i], slang);
-            if (args.debug_dump) {
-                spirvcross[i].dump_debug(args.error_format, slang);
-            }
-            if (spirvcross[i].error.valid) {
-                spirvcross[i].error.print(args.error_format);
-                return 10;
-            }
+    // write generated output files
+    {
+        trace_span_t span("write_output");
+        errmsg_t write_err = res.output.write_to_files();
+        if (write_err.valid) {
+            write_err.print(args.error_format);
+            return 10;
         }
     }
 
-    // compile shader-byte code if requested (HLSL / Metal)
-    std::array<bytecode_t, slang_t::NUM> bytecode;
-    if (args.byte_code) {
-        for (int i = 0; i < slang_t::NUM; i++) {
-            slang_t::type_t slang = (slang_t::type_t)i;
-            if (args.slang & slang_t::bit(slang)) {
-                bytecode[i] = bytecode_t::compile(args, inp, spirvcross[i], slang);
-                if (args.debug_dump) {
-                    bytecode[i].dump_debug();
-                }
-                if (!bytecode[i].errors.empty()) {
-                    bool has_errors = false;
-                    for (const errmsg_t& err: bytecode[i].errors) {
-                        if (err.type == errmsg_t::ERROR) {
-                            has_errors = true;
-                        }
-                        err.print(args.error_format);
-                    }
-                    if (has_errors) {
-                        return 10;
-                    }
-                }
-            }
+    // write phase timings if requested
+    if (trace_t::enabled) {
+        errmsg_t trace_err = trace_t::write(args.trace);
+        if (trace_err.valid) {
+            trace_err.print(args.error_format);
+            return 10;
         }
     }
 
-    // generate output files
-    errmsg_t output_err;
-    switch (args.output_format) {
-        case format_t::BARE:
-            output_err = bare_t::gen(args, inp, spirvcross, bytecode);
-            break;
-        case format_t::BARE_YAML:
-            output_err = bare_t::gen(args, inp, spirvcross, bytecode);
-            if (output_err.valid) {
-                break;
-            }
-            output_err = yaml_t::gen(args, inp, spirvcross, bytecode);
-            break;
-        case format_t::SOKOL_ZIG:
-            output_err = sokolzig_t::gen(args, inp, spirvcross, bytecode);
-            break;
-        case format_t::SOKOL_NIM:
-            output_err = sokolnim_t::gen(args, inp, spirvcross, bytecode);
-            break;
-        case format_t::SOKOL_ODIN:
-            output_err = sokolodin_t::gen(args, inp, spirvcross, bytecode);
-            break;
-        case format_t::SOKOL_RUST:
-            output_err = sokolrust_t::gen(args, inp, spirvcross, bytecode);
-            break;
-        default:
-            output_err = sokol_t::gen(args, inp, spirvcross, bytecode);
-            break;
-    }
-    if (output_err.valid) {
-        output_err.print(args.error_format);
-        return 10;
+    // print memory statistics if requested
+    if (memstats_t::enabled) {
+        memstats_t::print();
     }
 
     // success
@@ -0,0 +1,103 @@
+/*
+    heap allocation and peak memory accounting per compilation phase
+*/
+#include "shdc.h"
+#include "fmt/format.h"
+#include <stdio.h>
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace shdc {
+
+bool memstats_t::enabled = false;
+std::atomic<uint64_t> memstats_t::num_allocs(0);
+std::atomic<uint64_t> memstats_t::alloc_bytes(0);
+std::atomic<uint64_t> memstats_t::heap_bytes(0);
+std::atomic<uint64_t> memstats_t::peak_heap_bytes(0);
+std::vector<memstats_t::phase_t> memstats_t::phases;
+
+uint64_t memstats_t::peak_rss_kb() {
+    #if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return (uint64_t)counters.PeakWorkingSetSize / 1024;
+    }
+    return 0;
+    #else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    #if defined(__APPLE__)
+    return (uint64_t)usage.ru_maxrss / 1024;   // bytes on macOS
+    #else
+    return (uint64_t)usage.ru_maxrss;          // kilobytes on Linux
+    #endif
+    #endif
+}
+
+memstats_phase_t::memstats_phase_t(const std::string& name_) {
+    if (memstats_t::enabled) {
+        active = true;
+        name = name_;
+        start_allocs = memstats_t::num_allocs.load();
+        start_bytes = memstats_t::alloc_bytes.load();
+        // track the peak heap size of this phase separately, and restore
+        // the overall peak when the phase ends
+        outer_peak_heap_bytes = memstats_t::peak_heap_bytes.load();
+        memstats_t::peak_heap_bytes.store(memstats_t::heap_bytes.load());
+    }
+}
+
+memstats_phase_t::~memstats_phase_t() {
+    end();
+}
+
+void memstats_phase_t::end() {
+    if (!active) {
+        return;
+    }
+    active = false;
+    const uint64_t phase_peak = memstats_t::peak_heap_bytes.load();
+    memstats_t::peak_heap_bytes.store(std::max(outer_peak_heap_bytes, phase_peak));
+
+    // phases which run once per shader language are accumulated into one entry
+    auto it = std::find_if(memstats_t::phases.begin(), memstats_t::phases.end(),
+        [this](const memstats_t::phase_t& phase) { return phase.name == name; });
+    if (it == memstats_t::phases.end()) {
+        memstats_t::phase_t phase;
+        phase.name = name;
+        memstats_t::phases.push_back(phase);
+        it = memstats_t::phases.end() - 1;
+    }
+    it->num_allocs += memstats_t::num_allocs.load() - start_allocs;
+    it->alloc_bytes += memstats_t::alloc_bytes.load() - start_bytes;
+    it->peak_heap_bytes = std::max(it->peak_heap_bytes, phase_peak);
+    it->live_heap_bytes = memstats_t::heap_bytes.load();
+    it->peak_rss_kb = memstats_t::peak_rss_kb();
+}
+
+static double to_mb(uint64_t bytes) {
+    return (double)bytes / (1024.0 * 1024.0);
+}
+
+void memstats_t::print() {
+    fmt::print(stderr, "Memory statistics per compilation phase:\n\n");
+    fmt::print(stderr, "  {:<12} {:>10} {:>12} {:>12} {:>12} {:>12}\n",
+        "phase", "allocs", "alloc MB", "peak heap MB", "live heap MB", "peak RSS MB");
+    for (const phase_t& phase: phases) {
+        fmt::print(stderr, "  {:<12} {:>10} {:>12.2f} {:>12.2f} {:>12.2f} {:>12.2f}\n",
+            phase.name,
+            phase.num_allocs,
+            to_mb(phase.alloc_bytes),
+            to_mb(phase.peak_heap_bytes),
+            to_mb(phase.live_heap_bytes),
+            (double)phase.peak_rss_kb / 1024.0);
+    }
+    fmt::print(stderr, "\n  total: {} allocs, {:.2f} MB allocated, {:.2f} MB peak heap, {:.2f} MB peak RSS\n",
+        num_allocs.load(), to_mb(alloc_bytes.load()), to_mb(peak_heap_bytes.load()), (double)peak_rss_kb() / 1024.0);
+}
+
+} // namespace shdc
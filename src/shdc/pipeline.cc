@@ -0,0 +1,179 @@
+/*
+    the compilation pipeline from input source to generated output files,
+    shared by the command line tool and the library API
+*/
+#include "shdc.h"
+#include "fmt/format.h"
+#include <stdio.h>
+
+namespace shdc {
+
+void output_t::add(const std::string& path, const std::string& content) {
+    files.push_back({ path, content });
+}
+
+errmsg_t output_t::write_to_files() const {
+    for (const output_file_t& file: files) {
+        if (file.path == "-") {
+            fwrite(file.content.data(), 1, file.content.size(), stdout);
+            continue;
+        }
+        FILE* f = fopen(file.path.c_str(), "wb");
+        if (!f) {
+            return errmsg_t::error(file.path, -1, fmt::format("failed to open output file '{}'", file.path));
+        }
+        const size_t written = fwrite(file.content.data(), 1, file.content.size(), f);
+        fclose(f);
+        if (written != file.content.size()) {
+            return errmsg_t::error(file.path, -1, fmt::format("failed to write output file '{}'", file.path));
+        }
+    }
+    return errmsg_t();
+}
+
+// move errors and warnings into the diagnostics, return true if there were errors
+static bool has_errors(const std::vector<errmsg_t>& errors, std::vector<errmsg_t>& out_diagnostics) {
+    bool res = false;
+    for (const errmsg_t& err: errors) {
+        if (err.type == errmsg_t::ERROR) {
+            res = true;
+        }
+        out_diagnostics.push_back(err);
+    }
+    return res;
+}
+
+compile_result_t pipeline_t::compile(const args_t& args, const include_resolver_t& resolver) {
+    compile_result_t res;
+
+    // load the source and parse tagged blocks
+    input_t inp;
+    {
+        trace_span_t span("load_and_parse", {{ "file", args.input }});
+        memstats_phase_t mem_phase("input");
+        inp = input_t::load_and_parse(args.input, args.module, resolver);
+    }
+    if (args.debug_dump) {
+        inp.dump_debug(args.error_format);
+    }
+    if (inp.out_error.valid) {
+        res.diagnostics.push_back(inp.out_error);
+        return res;
+    }
+
+    // compile source snippets to SPIRV blobs and cross-translate them to shader
+    // dialects one shader language at a time, the SPIRV blobs are released as
+    // soon as they have been consumed, only the cross-compiled sources and
+    // reflection info are kept for the code generators
+    std::array<spirvcross_t,slang_t::NUM> spirvcross;
+    spirvcross_refl_cache_t refl_cache;
+    report_t report;
+    for (int i = 0; i < slang_t::NUM; i++) {
+        slang_t::type_t slang = (slang_t::type_t)i;
+        if (0 == (args.slang & slang_t::bit(slang))) {
+            continue;
+        }
+        spirv_t spirv;
+        {
+            trace_span_t span("compile_glsl", {{ "slang", slang_t::to_str(slang) }});
+            memstats_phase_t mem_phase("spirv");
+            spirv = spirv_t::compile_glsl(args, inp, slang);
+        }
+        if (args.debug_dump) {
+            spirv.dump_debug(inp, args.error_format);
+        }
+        if (has_errors(spirv.errors, res.diagnostics)) {
+            return res;
+        }
+        if (args.save_intermediate_spirv) {
+            if (!spirv.write_to_file(args, inp, slang)) {
+                res.diagnostics.push_back(errmsg_t::error(inp.base_path, -1, "failed to write intermediate SPIRV files"));
+                return res;
+            }
+        }
+        {
+            trace_span_t span("translate", {{ "slang", slang_t::to_str(slang) }});
+            memstats_phase_t mem_phase("crosscompile");
+            spirvcross[i] = spirvcross_t::translate(args, inp, spirv, slang, refl_cache);
+        }
+        if (args.debug_dump) {
+            spirvcross[i].dump_debug(args.error_format, slang);
+        }
+        if (spirvcross[i].error.valid) {
+            res.diagnostics.push_back(spirvcross[i].error);
+            return res;
+        }
+        if (!args.report.empty()) {
+            report.gather_shaders(inp, spirv, spirvcross[i], slang);
+        }
+    }
+
+    // write static shader cost report if requested
+    if (!args.report.empty()) {
+        trace_span_t span("report");
+        memstats_phase_t mem_phase("report");
+        report.gather_layouts(args, spirvcross);
+        report.write(args, inp, res.output);
+    }
+
+    // compile shader-byte code if requested (HLSL / Metal)
+    std::array<bytecode_t, slang_t::NUM> bytecode;
+    if (args.byte_code) {
+        for (int i = 0; i < slang_t::NUM; i++) {
+            slang_t::type_t slang = (slang_t::type_t)i;
+            if (args.slang & slang_t::bit(slang)) {
+                {
+                    trace_span_t span("compile_bytecode", {{ "slang", slang_t::to_str(slang) }});
+                    memstats_phase_t mem_phase("bytecode");
+                    bytecode[i] = bytecode_t::compile(args, inp, spirvcross[i], slang);
+                }
+                if (args.debug_dump) {
+                    bytecode[i].dump_debug();
+                }
+                if (has_errors(bytecode[i].errors, res.diagnostics)) {
+                    return res;
+                }
+            }
+        }
+    }
+
+    // generate output files into memory
+    errmsg_t output_err;
+    trace_span_t span("generate", {{ "format", format_t::to_str(args.output_format) }});
+    memstats_phase_t mem_phase("generate");
+    switch (args.output_format) {
+        case format_t::BARE:
+            output_err = bare_t::gen(args, inp, spirvcross, bytecode, res.output);
+            break;
+        case format_t::BARE_YAML:
+            output_err = bare_t::gen(args, inp, spirvcross, bytecode, res.output);
+            if (output_err.valid) {
+                break;
+            }
+            output_err = yaml_t::gen(args, inp, spirvcross, bytecode, res.output);
+            break;
+        case format_t::SOKOL_ZIG:
+            output_err = sokolzig_t::gen(args, inp, spirvcross, bytecode, res.output);
+            break;
+        case format_t::SOKOL_NIM:
+            output_err = sokolnim_t::gen(args, inp, spirvcross, bytecode, res.output);
+            break;
+        case format_t::SOKOL_ODIN:
+            output_err = sokolodin_t::gen(args, inp, spirvcross, bytecode, res.output);
+            break;
+        case format_t::SOKOL_RUST:
+            output_err = sokolrust_t::gen(args, inp, spirvcross, bytecode, res.output);
+            break;
+        default:
+            output_err = sokol_t::gen(args, inp, spirvcross, bytecode, res.output);
+            break;
+    }
+    if (output_err.valid) {
+        res.diagnostics.push_back(output_err);
+        return res;
+    }
+    res.success = true;
+    return res;
+}
+
+} // namespace shdc
@@ -0,0 +1,247 @@
+/*
+    static shader cost report, gathered from the optimized SPIRV bytecode
+*/
+#include "shdc.h"
+#include "fmt/format.h"
+#include "pystring.h"
+#include <stdio.h>
+
+namespace shdc {
+
+using namespace util;
+
+static std::string file_content;
+
+#if defined(_MSC_VER)
+#define L(str, ...) file_content.append(fmt::format(str, __VA_ARGS__))
+#else
+#define L(str, ...) file_content.append(fmt::format(str, ##__VA_ARGS__))
+#endif
+
+static bool is_alu_op(uint32_t op) {
+    // conversions, arithmetic, relational, logical, bit ops and derivatives
+    // are one contiguous range of opcodes, GLSL.std.450 math functions are OpExtInst
+    return ((op >= spv::OpConvertFToU) && (op <= spv::OpFwidthCoarse)) ||
+           (op == spv::OpExtInst) ||
+           (op == spv::OpTranspose);
+}
+
+static bool is_texture_op(uint32_t op) {
+    return (op >= spv::OpImageSampleImplicitLod) && (op <= spv::OpImageRead);
+}
+
+// instructions without a runtime cost which shouldn't be counted
+static bool is_structural_op(uint32_t op) {
+    switch (op) {
+        case spv::OpLabel:
+        case spv::OpLine:
+        case spv::OpNoLine:
+        case spv::OpSelectionMerge:
+        case spv::OpLoopMerge:
+        case spv::OpFunctionParameter:
+        case spv::OpVariable:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void count_instructions(const std::vector<uint32_t>& bytecode, report_shader_t& shd) {
+    // skip the 5-word SPIRV header
+    bool in_function = false;
+    size_t pos = 5;
+    while (pos < bytecode.size()) {
+        const uint32_t op = bytecode[pos] & spv::OpCodeMask;
+        const uint32_t word_count = bytecode[pos] >> spv::WordCountShift;
+        if (word_count == 0) {
+            // malformed bytecode, stop here instead of looping forever
+            break;
+        }
+        if (op == spv::OpFunction) {
+            in_function = true;
+        }
+        else if (op == spv::OpFunctionEnd) {
+            in_function = false;
+        }
+        else if (in_function) {
+            if (op == spv::OpLoopMerge) {
+                shd.num_loops++;
+            }
+            else if ((op == spv::OpBranchConditional) || (op == spv::OpSwitch)) {
+                shd.num_branches++;
+            }
+            else if (is_texture_op(op)) {
+                shd.num_texture_ops++;
+            }
+            else if (is_alu_op(op)) {
+                shd.num_alu_ops++;
+            }
+            if (!is_structural_op(op)) {
+                shd.num_instructions++;
+            }
+        }
+        pos += word_count;
+    }
+}
+
+// gather per-shader costs of one shader language, this is called right after
+// the cross-compilation so that the SPIRV blobs don't need to be kept around
+void report_t::gather_shaders(const input_t& inp, const spirv_t& spirv, const spirvcross_t& spirvcross, slang_t::type_t slang) {
+    for (const spirv_blob_t& blob: spirv.blobs) {
+        report_shader_t shd;
+        shd.snippet_index = blob.snippet_index;
+        shd.slang = slang;
+        count_instructions(blob.bytecode, shd);
+        int src_index = spirvcross.find_source_by_snippet_index(blob.snippet_index);
+        if (src_index >= 0) {
+            const spirvcross_refl_t& refl = spirvcross.sources[src_index].refl;
+            const bool is_vs = inp.snippets[blob.snippet_index].type == snippet_t::VS;
+            for (const attr_t& attr: is_vs ? refl.outputs : refl.inputs) {
+                if (attr.slot >= 0) {
+                    shd.num_interpolants++;
+                }
+            }
+            for (const uniform_block_t& ub: refl.uniform_blocks) {
+                shd.uniform_bytes += ub.size;
+            }
+        }
+        shaders.push_back(shd);
+    }
+}
+
+void report_t::gather_layouts(const args_t& args, const std::array<spirvcross_t,slang_t::NUM>& spirvcross) {
+    // uniform block padding is identical for all target languages
+    const int slang_index = (int)slang_t::first_valid(args.slang);
+    if (slang_index < slang_t::NUM) {
+        for (const uniform_block_t& ub: spirvcross[slang_index].unique_uniform_blocks) {
+            report_uniform_block_t rub;
+            rub.struct_name = ub.struct_name;
+            rub.size = roundup(ub.size, 16);
+            std::vector<std140_member_t> members;
+            for (const uniform_t& u: ub.uniforms) {
+                std140_member_t m;
+                m.size = uniform_size(u.type, u.array_count);
+                m.align = uniform_align(u.type, u.array_count);
+                members.push_back(m);
+                rub.used_bytes += m.size;
+            }
+            std::vector<int> offsets;
+            rub.packed_size = std140_layout(members, std140_packed_order(members), offsets);
+            uniform_blocks.push_back(rub);
+        }
+        // vertex attributes where the vertex format could be narrowed
+        for (const spirvcross_source_t& src: spirvcross[slang_index].sources) {
+            if (src.refl.stage != stage_t::VS) {
+                continue;
+            }
+            for (const attr_t& attr: src.refl.inputs) {
+                if ((attr.slot >= 0) && (attr.num_components > 0) && (attr.used_components != ((1u << attr.num_components) - 1))) {
+                    report_attr_t rattr;
+                    rattr.snippet_index = src.snippet_index;
+                    rattr.attr = attr;
+                    narrowable_attrs.push_back(rattr);
+                }
+            }
+        }
+    }
+}
+
+static void write_text(const input_t& inp, const report_t& report) {
+    L("Static shader cost report for '{}':\n\n", inp.base_path);
+    L("  {:<12} {:<16} {:<5} {:>7} {:>6} {:>6} {:>9} {:>6} {:>7} {:>9}\n",
+        "slang", "snippet", "stage", "instrs", "alu", "tex", "branches", "loops", "interp", "ub bytes");
+    for (const report_shader_t& shd: report.shaders) {
+        const snippet_t& snippet = inp.snippets[shd.snippet_index];
+        L("  {:<12} {:<16} {:<5} {:>7} {:>6} {:>6} {:>9} {:>6} {:>7} {:>9}\n",
+            slang_t::to_str(shd.slang),
+            snippet.name,
+            snippet_t::type_to_str(snippet.type),
+            shd.num_instructions,
+            shd.num_alu_ops,
+            shd.num_texture_ops,
+            shd.num_branches,
+            shd.num_loops,
+            shd.num_interpolants,
+            shd.uniform_bytes);
+    }
+    if (!report.uniform_blocks.empty()) {
+        L("\n  {:<30} {:>6} {:>6} {:>8} {:>7}\n", "uniform block", "size", "used", "padding", "packed");
+        for (const report_uniform_block_t& ub: report.uniform_blocks) {
+            L("  {:<30} {:>6} {:>6} {:>8} {:>7}\n", ub.struct_name, ub.size, ub.used_bytes, ub.size - ub.used_bytes, ub.packed_size);
+        }
+    }
+    if (!report.narrowable_attrs.empty()) {
+        L("\n  {:<16} {:<20} {:>5} {:<8} {:<6}\n", "vertex shader", "attribute", "slot", "type", "used");
+        for (const report_attr_t& rattr: report.narrowable_attrs) {
+            const attr_t& attr = rattr.attr;
+            L("  {:<16} {:<20} {:>5} {:<8} {:<6}\n",
+                inp.snippets[rattr.snippet_index].name,
+                attr.name,
+                attr.slot,
+                fmt::format("{}{}", attr_t::base_type_to_str(attr.base_type), attr.num_components),
+                attr.used_components_str());
+        }
+    }
+}
+
+static void write_json(const input_t& inp, const report_t& report) {
+    L("{{\n");
+    L("  \"input\": \"{}\",\n", util::json_escape(inp.base_path));
+    L("  \"shaders\": [\n");
+    for (int i = 0; i < (int)report.shaders.size(); i++) {
+        const report_shader_t& shd = report.shaders[i];
+        const snippet_t& snippet = inp.snippets[shd.snippet_index];
+        L("    {{\n");
+        L("      \"slang\": \"{}\",\n", slang_t::to_str(shd.slang));
+        L("      \"snippet\": \"{}\",\n", snippet.name);
+        L("      \"stage\": \"{}\",\n", snippet_t::type_to_str(snippet.type));
+        L("      \"instructions\": {},\n", shd.num_instructions);
+        L("      \"alu_ops\": {},\n", shd.num_alu_ops);
+        L("      \"texture_ops\": {},\n", shd.num_texture_ops);
+        L("      \"branches\": {},\n", shd.num_branches);
+        L("      \"loops\": {},\n", shd.num_loops);
+        L("      \"interpolants\": {},\n", shd.num_interpolants);
+        L("      \"uniform_bytes\": {}\n", shd.uniform_bytes);
+        L("    }}{}\n", (i < ((int)report.shaders.size() - 1)) ? "," : "");
+    }
+    L("  ],\n");
+    L("  \"uniform_blocks\": [\n");
+    for (int i = 0; i < (int)report.uniform_blocks.size(); i++) {
+        const report_uniform_block_t& ub = report.uniform_blocks[i];
+        L("    {{\n");
+        L("      \"name\": \"{}\",\n", ub.struct_name);
+        L("      \"size\": {},\n", ub.size);
+        L("      \"used_bytes\": {},\n", ub.used_bytes);
+        L("      \"padding_bytes\": {},\n", ub.size - ub.used_bytes);
+        L("      \"packed_size\": {}\n", ub.packed_size);
+        L("    }}{}\n", (i < ((int)report.uniform_blocks.size() - 1)) ? "," : "");
+    }
+    L("  ],\n");
+    L("  \"narrowable_attrs\": [\n");
+    for (int i = 0; i < (int)report.narrowable_attrs.size(); i++) {
+        const report_attr_t& rattr = report.narrowable_attrs[i];
+        L("    {{\n");
+        L("      \"vertex_shader\": \"{}\",\n", inp.snippets[rattr.snippet_index].name);
+        L("      \"name\": \"{}\",\n", rattr.attr.name);
+        L("      \"slot\": {},\n", rattr.attr.slot);
+        L("      \"base_type\": \"{}\",\n", attr_t::base_type_to_str(rattr.attr.base_type));
+        L("      \"num_components\": {},\n", rattr.attr.num_components);
+        L("      \"used_components\": \"{}\"\n", rattr.attr.used_components_str());
+        L("    }}{}\n", (i < ((int)report.narrowable_attrs.size() - 1)) ? "," : "");
+    }
+    L("  ]\n");
+    L("}}\n");
+}
+
+void report_t::write(const args_t& args, const input_t& inp, output_t& out) const {
+    file_content.clear();
+    if (args.report_format == report_format_t::JSON) {
+        write_json(inp, *this);
+    }
+    else {
+        write_text(inp, *this);
+    }
+    out.add(args.report, file_content);
+}
+
+} // namespace shdc
@@ -6,6 +6,10 @@
 #include <vector>
 #include <array>
 #include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include "fmt/format.h"
 #include "spirv_cross.hpp"
 
@@ -23,6 +27,7 @@ struct slang_t {
         METAL_IOS,
         METAL_SIM,
         WGSL,
+        SPIRV,
         NUM
     };
 
@@ -40,6 +45,7 @@ struct slang_t {
             case METAL_IOS:     return "metal_ios";
             case METAL_SIM:     return "metal_sim";
             case WGSL:          return "wgsl";
+            case SPIRV:         return "spirv";
             default:            return "<invalid>";
         }
     }
@@ -89,6 +95,9 @@ struct slang_t {
     static bool is_wgsl(type_t c) {
         return WGSL == c;
     }
+    static bool is_spirv(type_t c) {
+        return SPIRV == c;
+    }
     static slang_t::type_t first_valid(uint32_t mask) {
         int i = 0;
         for (i = 0; i < NUM; i++) {
@@ -164,6 +173,69 @@ struct format_t	{
     }
 };
 
+// how shader sources and bytecode are embedded into generated C headers
+struct embed_t {
+    enum type_t {
+        BYTES = 0,      // hex byte arrays (default, most portable)
+        STRING,         // chunked, escaped string literals
+        EMBED,          // C23 #embed referencing sidecar files
+        NUM,
+        INVALID,
+    };
+
+    static const char* to_str(type_t e) {
+        switch (e) {
+            case BYTES:     return "bytes";
+            case STRING:    return "string";
+            case EMBED:     return "embed";
+            default:        return "<invalid>";
+        }
+    }
+    static type_t from_str(const std::string& str) {
+        if (str == "bytes") {
+            return BYTES;
+        }
+        else if (str == "string") {
+            return STRING;
+        }
+        else if (str == "embed") {
+            return EMBED;
+        }
+        else {
+            return INVALID;
+        }
+    }
+};
+
+// file format of the shader cost report
+struct report_format_t {
+    enum type_t {
+        TEXT = 0,
+        JSON,
+        NUM,
+        INVALID,
+    };
+
+    static const char* to_str(type_t f) {
+        switch (f) {
+            case TEXT:  return "text";
+            case JSON:  return "json";
+            default:    return "<invalid>";
+        }
+    }
+    static type_t from_str(const std::string& str) {
+        if (str == "text") {
+            return TEXT;
+        }
+        else if (str == "json") {
+            return JSON;
+        }
+        else {
+            return INVALID;
+        }
+    }
+};
+
 // an error message object with filename, line number and message
 struct errmsg_t {
     enum type_t {
@@ -173,7 +245,7 @@ struct errmsg_t {
     type_t type = ERROR;
     std::string file;
     std::string msg;
-    int line_index = -1;      // line_index is zero-based!
+    int line_index = -1;      // line_index is zero-based, -1 if unknown!
     bool valid = false;
     // format for error message
     enum msg_format_t {
@@ -202,10 +274,10 @@ struct errmsg_t {
 
     std::string as_string(msg_format_t fmt) const {
         if (fmt == MSVC) {
-            return fmt::format("{}({}): {}: {}", file, line_index, (type==ERROR)?"error":"warning", msg);
+            return fmt::format("{}({}): {}: {}", file, std::max(line_index, 0), (type==ERROR)?"error":"warning", msg);
         }
         else {
-            return fmt::format("{}:{}:0: {}: {}", file, line_index, (type==ERROR)?"error":"warning", msg);
+            return fmt::format("{}:{}:0: {}: {}", file, std::max(line_index, 0), (type==ERROR)?"error":"warning", msg);
         }
     }
     // print error to stdout
@@ -236,13 +308,26 @@ struct args_t {
     bool byte_code = false;             // output byte code (for HLSL and MetalSL)
     bool reflection = false;            // if true, generate runtime reflection functions
     format_t::type_t output_format = format_t::SOKOL; // output format
+    embed_t::type_t embed = embed_t::BYTES; // how sources and bytecode are embedded in C headers
     bool debug_dump = false;            // print debug-dump info
     bool ifdef = false;                 // wrap backend specific shaders into #ifdefs (SOKOL_D3D11 etc...)
     bool save_intermediate_spirv = false;   // save intermediate SPIRV bytecode (glslangvalidator output)
+    bool pack_uniforms = false;         // reorder uniform block members to minimize padding
+    bool relax_precision = false;       // relax fragment shader precision on mobile shader languages
+    bool link_opt = false;              // remove vertex shader outputs which are not read by the fragment shader
+    bool global_bind_slots = false;     // same bind slot for a resource name in all shaders
+    std::string report;                 // optional path of static shader cost report ('-' for stdout)
+    std::string trace;                  // optional path of Chrome trace-event file with phase timings
+    bool mem_stats = false;             // print heap allocations and peak memory per compilation phase
+    std::string pack;                   // optional shader source pack file to load input files from
+    report_format_t::type_t report_format = report_format_t::TEXT; // file format of cost report
     int gen_version = 1;                // generator-version stamp
     errmsg_t::msg_format_t error_format = errmsg_t::GCC;  // format for error messages
+    bool help = false;                  // --help was given, the caller prints the help text
+    std::vector<std::string> errors;    // command line errors, printed by the caller
 
     static args_t parse(int argc, const char** argv);
+    static void print_help();
     void dump_debug() const;
 };
 
@@ -252,6 +337,8 @@ struct option_t {
         INVALID = 0,
         FIXUP_CLIPSPACE = (1<<0),
         FLIP_VERT_Y = (1<<1),
+        RELAX_PRECISION = (1<<2),
+        FULL_PRECISION = (1<<3),
 
         NUM
     };
@@ -263,6 +350,12 @@ struct option_t {
         else if (str == "flip_vert_y") {
             return FLIP_VERT_Y;
         }
+        else if (str == "relax_precision") {
+            return RELAX_PRECISION;
+        }
+        else if (str == "full_precision") {
+            return FULL_PRECISION;
+        }
         else {
             return INVALID;
         }
@@ -281,6 +374,8 @@ struct snippet_t {
     std::array<uint32_t, slang_t::NUM> options = { };
     std::string name;
     std::vector<int> lines; // resolved zero-based line-indices (including @include_block)
+    std::vector<std::string> defines;   // NAME or NAME=VALUE defines of a specialized @program clone
+    bool specialized_only = false;      // only used through specialized clones, not compiled
 
     snippet_t() { };
     snippet_t(type_t t, const std::string& n): type(t), name(n) { };
@@ -301,6 +396,7 @@ struct program_t {
     std::string vs_name;    // name of vertex shader snippet
     std::string fs_name;    // name of fragment shader snippet
     int line_index = -1;    // line index in input source (zero-based)
+    std::vector<std::string> defines;   // optional NAME or NAME=VALUE defines
 
     program_t() { };
     program_t(const std::string& n, const std::string& vs, const std::string& fs, int l): name(n), vs_name(vs), fs_name(fs), line_index(l) { };
@@ -316,6 +412,23 @@ struct line_t {
     line_t(const std::string& ln, int fn, int ix): line(ln), filename(fn), index(ix) { };
 };
 
+// loads the content of the input file and @include files, returns false if the
+// file doesn't exist, see vfs_t for the builtin resolvers
+typedef std::function<bool(const std::string& path, std::string& out_content)> include_resolver_t;
+
+// include resolver backends: the filesystem, an in-memory path => content map,
+// or a shader source pack file (a single file with all shader sources, written
+// by scripts/shdc-pack.py) which is loaded into memory with one file read
+struct vfs_t {
+    typedef std::map<std::string, std::string> files_t;
+
+    static include_resolver_t file_resolver();
+    static include_resolver_t memory_resolver(files_t files);
+    static errmsg_t load_pack(const std::string& pack_path, files_t& out_files);
+    static errmsg_t pack_resolver(const std::string& pack_path, include_resolver_t& out_resolver);
+    static std::string normalize_path(const std::string& path);
+};
+
 // pre-parsed GLSL source file, with content split into snippets
 struct input_t {
     errmsg_t out_error;
@@ -333,7 +446,7 @@ struct input_t {
     std::map<std::string, program_t> programs;    // all @program definitions
 
     input_t() { };
-    static input_t load_and_parse(const std::string& path, const std::string& module_override);
+    static input_t load_and_parse(const std::string& path, const std::string& module_override, const include_resolver_t& resolver);
     void dump_debug(errmsg_t::msg_format_t err_fmt) const;
 
     errmsg_t error(int index, const std::string& msg) const {
@@ -359,7 +472,7 @@ struct input_t {
 // a SPIRV-bytecode blob with "back-link" to input_t.snippets
 struct spirv_blob_t {
     int snippet_index = -1;         // index into input_t.snippets
-    std::string source;             // source code this blob was compiled from
+    std::string source;             // source code this blob was compiled from (only for debug dump and --save-intermediate-spirv)
     std::vector<uint32_t> bytecode; // the resulting SPIRV blob
 
     spirv_blob_t(int snippet_index): snippet_index(snippet_index) { };
@@ -371,9 +484,9 @@ struct spirv_t {
     std::vector<errmsg_t> errors;
     std::vector<spirv_blob_t> blobs;
 
-    static void initialize_spirv_tools();
+    static void initialize_spirv_tools();   // called by compile_glsl() on first use
     static void finalize_spirv_tools();
-    static spirv_t compile_glsl(const input_t& inp, slang_t::type_t slang, const std::vector<std::string>& defines);
+    static spirv_t compile_glsl(const args_t& args, const input_t& inp, slang_t::type_t slang);
     bool write_to_file(const args_t& args, const input_t& inp, slang_t::type_t slang);
     void dump_debug(const input_t& inp, errmsg_t::msg_format_t err_fmt) const;
 };
@@ -385,6 +498,33 @@ struct attr_t {
     std::string name;
     std::string sem_name;
     int sem_index = 0;
+    enum base_type_t {
+        BASETYPE_INVALID,
+        BASETYPE_FLOAT,
+        BASETYPE_INT,
+        BASETYPE_UINT,
+    };
+    base_type_t base_type = BASETYPE_INVALID;   // declared component type
+    int num_components = 0;                     // declared number of components (1..4)
+    uint32_t used_components = 0;               // bitmask of components actually read by the shader (bit 0 = x)
+
+    static const char* base_type_to_str(base_type_t t) {
+        switch (t) {
+            case BASETYPE_FLOAT:    return "float";
+            case BASETYPE_INT:      return "int";
+            case BASETYPE_UINT:     return "uint";
+            default:                return "invalid";
+        }
+    }
+
+    // e.g. "xyz_" for a vec4 where only .xyz is read
+    std::string used_components_str() const {
+        std::string str;
+        for (int i = 0; i < num_components; i++) {
+            str += (used_components & (1u << i)) ? "xyzw"[i] : '_';
+        }
+        return str;
+    }
 
     bool equals(const attr_t& rhs) const {
         return (slot == rhs.slot) &&
@@ -412,6 +552,9 @@ struct uniform_t {
     type_t type = INVALID;
     int array_count = 1;
     int offset = 0;
+    bool active = true;     // false if the member is never read by the shader
+    int active_offset = 0;  // start of byte range read by the shader (relative to block start)
+    int active_size = 0;    // size of byte range read by the shader, 0 if unknown or inactive
 
     static const char* type_to_str(type_t t) {
         switch (t) {
@@ -445,6 +588,28 @@ struct uniform_block_t {
     std::vector<uniform_t> uniforms;
     int unique_index = -1;      // index into spirvcross_t.unique_uniform_blocks
     bool flattened = false;
+    int active_prefix_size = 0; // size of the block prefix read by the shader (rounded up to 16)
+
+    // union of active ranges when the same block is used by multiple shaders
+    void merge_active(const uniform_block_t& other) {
+        active_prefix_size = std::max(active_prefix_size, other.active_prefix_size);
+        for (int i = 0; (i < (int)uniforms.size()) && (i < (int)other.uniforms.size()); i++) {
+            uniform_t& u = uniforms[i];
+            const uniform_t& other_u = other.uniforms[i];
+            if (other_u.active_size > 0) {
+                if (u.active_size == 0) {
+                    u.active_offset = other_u.active_offset;
+                    u.active_size = other_u.active_size;
+                }
+                else {
+                    const int end = std::max(u.active_offset + u.active_size, other_u.active_offset + other_u.active_size);
+                    u.active_offset = std::min(u.active_offset, other_u.active_offset);
+                    u.active_size = end - u.active_offset;
+                }
+            }
+            u.active |= other_u.active;
+        }
+    }
 
     // FIXME: hmm is this correct??
     bool equals(const uniform_block_t& other) const {
@@ -584,6 +749,11 @@ struct spirvcross_refl_t {
     std::vector<image_t> images;
     std::vector<sampler_t> samplers;
     std::vector<image_sampler_t> image_samplers;
+    // fragment shader properties which affect early depth testing
+    bool uses_discard = false;          // contains 'discard'
+    bool writes_depth = false;          // writes gl_FragDepth
+    bool has_side_effects = false;      // writes to images, buffers or atomics
+    bool sample_rate = false;           // requires per-sample shading
 };
 
 // a helper struct to transfer symbol names from SPIRVCross to Tint
@@ -596,15 +766,31 @@ struct spirvcross_wgsl_symbol_table_t {
     std::map<uint32_t, std::string> sampler_names;
 };
 
+// bind slots by resource name, shared by all shaders (--global-bind-slots)
+struct spirvcross_bind_slots_t {
+    bool valid = false;
+    std::map<std::string, int> uniform_blocks;
+    std::map<std::string, int> images;
+    std::map<std::string, int> samplers;
+};
+
 // result of a spirv-cross compilation
 struct spirvcross_source_t {
     bool valid = false;
     int snippet_index = -1;
     std::string source_code;
+    std::vector<uint32_t> spirv;    // only for slang_t::SPIRV, source_code is the disassembly
     errmsg_t error;
     spirvcross_refl_t refl;
 };
 
+// target-independent reflection of shader snippets, shared by all shader
+// languages which compiled a snippet to identical SPIRV
+struct spirvcross_refl_cache_t {
+    typedef std::pair<int, uint64_t> key_t;    // snippet index and hash of SPIRV content and global bind slots
+    std::map<key_t, spirvcross_refl_t> items;
+};
+
 // spirv-cross wrapper
 struct spirvcross_t {
     errmsg_t error;
@@ -612,8 +798,14 @@ struct spirvcross_t {
     std::vector<uniform_block_t> unique_uniform_blocks;
     std::vector<image_t> unique_images;
     std::vector<sampler_t> unique_samplers;
+    // lookup indexes, these are updated by add_source() and the unique-resource gathering
+    std::vector<int> source_index_by_snippet;   // snippet index => index into sources, or -1
+    std::unordered_map<std::string, int> unique_uniform_block_index_by_name;
+    std::unordered_map<std::string, int> unique_image_index_by_name;
+    std::unordered_map<std::string, int> unique_sampler_index_by_name;
 
-    static spirvcross_t translate(const input_t& inp, const spirv_t& spirv, slang_t::type_t slang);
+    static spirvcross_t translate(const args_t& args, const input_t& inp, const spirv_t& spirv, slang_t::type_t slang, spirvcross_refl_cache_t& refl_cache);
+    void add_source(spirvcross_source_t&& src);
     int find_source_by_snippet_index(int snippet_index) const;
     void dump_debug(errmsg_t::msg_format_t err_fmt, slang_t::type_t slang) const;
 };
@@ -628,56 +820,212 @@ struct bytecode_blob_t {
 struct bytecode_t {
     std::vector<errmsg_t> errors;
     std::vector<bytecode_blob_t> blobs;
+    std::vector<int> blob_index_by_snippet;     // snippet index => index into blobs, or -1
 
     static bytecode_t compile(const args_t& args, const input_t& inp, const spirvcross_t& spirvcross, slang_t::type_t slang);
+    void add_blob(bytecode_blob_t&& blob);
     int find_blob_by_snippet_index(int snippet_index) const;
     void dump_debug() const;
 };
 
+// static cost metrics of one compiled shader snippet
+struct report_shader_t {
+    int snippet_index = -1;
+    slang_t::type_t slang = slang_t::NUM;
+    int num_instructions = 0;   // all instructions in function bodies
+    int num_alu_ops = 0;        // arithmetic, conversion, comparison, bit and math ops
+    int num_texture_ops = 0;    // image sample, fetch, gather and read ops
+    int num_branches = 0;       // conditional branches and switches
+    int num_loops = 0;
+    int num_interpolants = 0;   // vertex shader outputs or fragment shader inputs
+    int uniform_bytes = 0;      // size of all uniform blocks
+};
+
+// std140 padding analysis of one uniform block
+struct report_uniform_block_t {
+    std::string struct_name;
+    int size = 0;               // size rounded up to 16 bytes
+    int used_bytes = 0;         // bytes occupied by members, the rest is padding
+    int packed_size = 0;        // size with minimal-padding member order (see --pack-uniforms)
+};
+
+// vertex attribute which isn't fully read by the vertex shader
+struct report_attr_t {
+    int snippet_index = -1;
+    attr_t attr;
+};
+
+// static shader cost report (--report)
+struct output_t;
+struct report_t {
+    std::vector<report_shader_t> shaders;
+    std::vector<report_uniform_block_t> uniform_blocks;
+    std::vector<report_attr_t> narrowable_attrs;
+
+    void gather_shaders(const input_t& inp, const spirv_t& spirv, const spirvcross_t& spirvcross, slang_t::type_t slang);
+    void gather_layouts(const args_t& args, const std::array<spirvcross_t,slang_t::NUM>& spirvcross);
+    void write(const args_t& args, const input_t& inp, output_t& out) const;
+};
+
+// phase timing in Chrome trace-event format (--trace)
+struct trace_t {
+    typedef std::vector<std::pair<std::string, std::string>> args_t;
+    struct event_t {
+        std::string name;
+        args_t args;
+        uint64_t start_us = 0;
+        uint64_t duration_us = 0;
+    };
+    static bool enabled;
+    static std::vector<event_t> events;
+
+    static uint64_t now_us();
+    static void add(const std::string& name, const args_t& args, uint64_t start_us);
+    static errmsg_t write(const std::string& path);
+};
+
+// records a trace event spanning the lifetime of the object
+struct trace_span_t {
+    std::string name;
+    trace_t::args_t args;
+    uint64_t start_us = 0;
+    bool active = false;
+
+    trace_span_t(const std::string& name, trace_t::args_t args = trace_t::args_t());
+    ~trace_span_t();
+    void end();
+};
+
+// heap allocation and peak memory accounting per compilation phase (--mem-stats),
+// the allocation counters are updated by the global operator new/delete in main.cc
+struct memstats_t {
+    struct phase_t {
+        std::string name;
+        uint64_t num_allocs = 0;        // number of heap allocations in the phase
+        uint64_t alloc_bytes = 0;       // number of bytes allocated in the phase
+        uint64_t peak_heap_bytes = 0;   // peak live heap size during the phase
+        uint64_t live_heap_bytes = 0;   // live heap size at the end of the phase
+        uint64_t peak_rss_kb = 0;       // process peak RSS at the end of the phase
+    };
+    static bool enabled;
+    static std::atomic<uint64_t> num_allocs;
+    static std::atomic<uint64_t> alloc_bytes;
+    static std::atomic<uint64_t> heap_bytes;
+    static std::atomic<uint64_t> peak_heap_bytes;
+    static std::vector<phase_t> phases;
+
+    static void on_alloc(uint64_t size) {
+        num_allocs.fetch_add(1, std::memory_order_relaxed);
+        alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+        const uint64_t cur = heap_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+        uint64_t peak = peak_heap_bytes.load(std::memory_order_relaxed);
+        while ((cur > peak) && !peak_heap_bytes.compare_exchange_weak(peak, cur, std::memory_order_relaxed));
+    }
+    static void on_free(uint64_t size) {
+        heap_bytes.fetch_sub(size, std::memory_order_relaxed);
+    }
+    static uint64_t peak_rss_kb();
+    static void print();
+};
+
+// accumulates the allocations during the lifetime of the object into a memstats_t phase
+struct memstats_phase_t {
+    std::string name;
+    uint64_t start_allocs = 0;
+    uint64_t start_bytes = 0;
+    uint64_t outer_peak_heap_bytes = 0;
+    bool active = false;
+
+    memstats_phase_t(const std::string& name);
+    ~memstats_phase_t();
+    void end();
+};
+
+// a generated output file, the content is text or binary data
+struct output_file_t {
+    std::string path;
+    std::string content;
+};
+
+// all output files created by the code generators and the cost report, these
+// are written to disk by the command line tool (a path of '-' is written to
+// stdout), or returned as memory buffers by the library API
+struct output_t {
+    std::vector<output_file_t> files;
+
+    void add(const std::string& path, const std::string& content);
+    errmsg_t write_to_files() const;
+};
+
 // C header-generator for sokol_gfx.h
 struct sokol_t {
-    static errmsg_t gen(const args_t& args, const input_t& inp, const std::array<spirvcross_t,slang_t::NUM>& spirvcross, const std::array<bytecode_t,slang_t::NUM>& bytecode);
+    static errmsg_t gen(const args_t& args, const input_t& inp, const std::array<spirvcross_t,slang_t::NUM>& spirvcross, const std::array<bytecode_t,slang_t::NUM>& bytecode, output_t& out);
 };
 
 // Zig module-generator for sokol-zig
 struct sokolzig_t {
-    static errmsg_t gen(const args_t& args, const input_t& inp, const std::array<spirvcross_t,slang_t::NUM>& spirvcross, const std::array<bytecode_t,slang_t::NUM>& bytecode);
+    static errmsg_t gen(const args_t& args, const input_t& inp, const std::array<spirvcross_t,slang_t::NUM>& spirvcross, const std::array<bytecode_t,slang_t::NUM>& bytecode, output_t& out);
 };
 
 // Nim module-generator for sokol-nim
 struct sokolnim_t {
-    static errmsg_t gen(const args_t& args, const input_t& inp, const std::array<spirvcross_t,slang_t::NUM>& spirvcross, const std::array<bytecode_t,slang_t::NUM>& bytecode);
+    static errmsg_t gen(const args_t& args, const input_t& inp, const std::array<spirvcross_t,slang_t::NUM>& spirvcross, const std::array<bytecode_t,slang_t::NUM>& bytecode, output_t& out);
 };
 
 // Odin module-generator for sokol-odin
 struct sokolodin_t {
-    static errmsg_t gen(const args_t& args, const input_t& inp, const std::array<spirvcross_t,slang_t::NUM>& spirvcross, const std::array<bytecode_t,slang_t::NUM>& bytecode);
+    static errmsg_t gen(const args_t& args, const input_t& inp, const std::array<spirvcross_t,slang_t::NUM>& spirvcross, const std::array<bytecode_t,slang_t::NUM>& bytecode, output_t& out);
 };
 
 // Rust module-generator for sokol-rust
 struct sokolrust_t {
-    static errmsg_t gen(const args_t& args, const input_t& inp, const std::array<spirvcross_t,slang_t::NUM>& spirvcross, const std::array<bytecode_t,slang_t::NUM>& bytecode);
+    static errmsg_t gen(const args_t& args, const input_t& inp, const std::array<spirvcross_t,slang_t::NUM>& spirvcross, const std::array<bytecode_t,slang_t::NUM>& bytecode, output_t& out);
 };
 
 // bare format generator
 struct bare_t {
     static const char* slang_file_extension(slang_t::type_t c, bool binary);
-    static errmsg_t gen(const args_t& args, const input_t& inp, const std::array<spirvcross_t,slang_t::NUM>& spirvcross, const std::array<bytecode_t,slang_t::NUM>& bytecode);
+    static errmsg_t gen(const args_t& args, const input_t& inp, const std::array<spirvcross_t,slang_t::NUM>& spirvcross, const std::array<bytecode_t,slang_t::NUM>& bytecode, output_t& out);
 };
 
 // yaml reflection format generator
 struct yaml_t {
-    static errmsg_t gen(const args_t& args, const input_t& inp, const std::array<spirvcross_t,slang_t::NUM>& spirvcross, const std::array<bytecode_t,slang_t::NUM>& bytecode);
+    static errmsg_t gen(const args_t& args, const input_t& inp, const std::array<spirvcross_t,slang_t::NUM>& spirvcross, const std::array<bytecode_t,slang_t::NUM>& bytecode, output_t& out);
+};
+
+// result of running the whole compilation pipeline
+struct compile_result_t {
+    bool success = false;
+    std::vector<errmsg_t> diagnostics;  // errors and warnings
+    output_t output;
+};
+
+// the compilation pipeline from input source to generated output files, shared
+// by the sokol-shdc command line tool and the library API (see shdc_api.h)
+struct pipeline_t {
+    static compile_result_t compile(const args_t& args, const include_resolver_t& resolver);
 };
 
 // utility functions for generators
 namespace util {
+    // size and alignment of a uniform block member in std140 layout
+    struct std140_member_t {
+        int size = 0;
+        int align = 0;
+    };
+
     errmsg_t check_errors(const input_t& inp, const spirvcross_t& spirvcross, slang_t::type_t slang);
     const char* uniform_type_str(uniform_t::type_t type);
     int uniform_size(uniform_t::type_t type, int array_size);
+    int uniform_align(uniform_t::type_t type, int array_size);
+    int std140_layout(const std::vector<std140_member_t>& members, const std::vector<int>& order, std::vector<int>& out_offsets);
+    std::vector<int> std140_packed_order(const std::vector<std140_member_t>& members);
     int roundup(int val, int round_to);
     std::string mod_prefix(const input_t& inp);
+    // linear searches in the reflection info of one shader, the number of resources
+    // per shader is bounded by the sokol-gfx limits
     const uniform_block_t* find_uniform_block_by_slot(const spirvcross_refl_t& refl, int slot);
+    const uniform_block_t* find_uniform_block_by_name(const spirvcross_refl_t& refl, const std::string& struct_name);
     const image_t* find_image_by_slot(const spirvcross_refl_t& refl, int slot);
     const image_t* find_image_by_name(const spirvcross_refl_t& refl, const std::string& name);
     const sampler_t* find_sampler_by_slot(const spirvcross_refl_t& refl, int slot);
@@ -690,6 +1038,11 @@ namespace util {
     std::string to_ada_case(const std::string& str);
     std::string to_upper_case(const std::string& str);
     std::string replace_C_comment_tokens(const std::string& str);
+    std::string json_escape(const std::string& str);
+    bool is_valid_define(const std::string& define);
+    uint64_t fnv1a64(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ULL);
+    uint64_t program_hash(const program_t& prog, const input_t& inp, const spirvcross_t& spirvcross, const bytecode_t& bytecode, slang_t::type_t slang);
+    std::string define_to_glsl(const std::string& define);
 };
 
 } // namespace shdc
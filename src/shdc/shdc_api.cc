@@ -0,0 +1,118 @@
+/*
+    C API wrapper around the compilation pipeline
+*/
+#include "shdc.h"
+#include "shdc_api.h"
+
+using namespace shdc;
+
+struct shdc_result_t {
+    compile_result_t res;
+};
+
+// the compiler backends are initialized on first use, but can be
+// initialized upfront to take the cost out of the first shdc_compile()
+void shdc_setup(void) {
+    spirv_t::initialize_spirv_tools();
+}
+
+void shdc_shutdown(void) {
+    spirv_t::finalize_spirv_tools();
+}
+
+shdc_result_t* shdc_compile(const shdc_desc_t* desc) {
+    shdc_result_t* result = new shdc_result_t();
+    if (!desc || !desc->path || !desc->output) {
+        result->res.diagnostics.push_back(errmsg_t::error("", -1, "shdc_compile: path and output must be provided"));
+        return result;
+    }
+
+    // build a command line with the input and output path and parse it like the command line tool
+    std::vector<const char*> argv = { "sokol-shdc", "-i", desc->path, "-o", desc->output };
+    for (int i = 0; i < desc->num_args; i++) {
+        argv.push_back(desc->args[i]);
+    }
+    const args_t args = args_t::parse((int)argv.size(), argv.data());
+    if (!args.valid) {
+        for (const std::string& err: args.errors) {
+            result->res.diagnostics.push_back(errmsg_t::error(desc->path, -1, fmt::format("shdc_compile: {}", err)));
+        }
+        if (args.help) {
+            result->res.diagnostics.push_back(errmsg_t::error(desc->path, -1, "shdc_compile: --help is not supported"));
+        }
+        return result;
+    }
+    // phase timings and memory statistics are process-wide and only supported by the command line tool
+    if (!args.trace.empty() || args.mem_stats) {
+        result->res.diagnostics.push_back(errmsg_t::error(desc->path, -1, "shdc_compile: --trace and --mem-stats are not supported"));
+        return result;
+    }
+
+    // the input file may be provided in memory, everything else goes through
+    // the user callback, or the pack file or filesystem
+    include_resolver_t default_resolver = vfs_t::file_resolver();
+    if (!args.pack.empty()) {
+        errmsg_t pack_err = vfs_t::pack_resolver(args.pack, default_resolver);
+        if (pack_err.valid) {
+            result->res.diagnostics.push_back(pack_err);
+            return result;
+        }
+    }
+    const include_resolver_t resolver = [desc, &default_resolver](const std::string& path, std::string& out_content) -> bool {
+        if (desc->source && (path == desc->path)) {
+            out_content = desc->source;
+            return true;
+        }
+        if (desc->include_func) {
+            size_t size = 0;
+            const char* content = desc->include_func(path.c_str(), &size, desc->user_data);
+            if (!content) {
+                return false;
+            }
+            out_content.assign(content, size);
+            return true;
+        }
+        return default_resolver(path, out_content);
+    };
+    result->res = pipeline_t::compile(args, resolver);
+    return result;
+}
+
+bool shdc_result_success(const shdc_result_t* res) {
+    return res && res->res.success;
+}
+
+int shdc_result_num_outputs(const shdc_result_t* res) {
+    return res ? (int)res->res.output.files.size() : 0;
+}
+
+shdc_output_t shdc_result_output(const shdc_result_t* res, int index) {
+    shdc_output_t out = { };
+    if (res && (index >= 0) && (index < (int)res->res.output.files.size())) {
+        const output_file_t& file = res->res.output.files[index];
+        out.path = file.path.c_str();
+        out.data = file.content.data();
+        out.size = file.content.size();
+    }
+    return out;
+}
+
+int shdc_result_num_diagnostics(const shdc_result_t* res) {
+    return res ? (int)res->res.diagnostics.size() : 0;
+}
+
+shdc_diagnostic_t shdc_result_diagnostic(const shdc_result_t* res, int index) {
+    shdc_diagnostic_t diag = { };
+    if (res && (index >= 0) && (index < (int)res->res.diagnostics.size())) {
+        const errmsg_t& err = res->res.diagnostics[index];
+        diag.error = err.type == errmsg_t::ERROR;
+        diag.file = err.file.c_str();
+        diag.line = (err.line_index >= 0) ? (err.line_index + 1) : 0;
+        diag.message = err.msg.c_str();
+    }
+    return diag;
+}
+
+void shdc_result_free(shdc_result_t* res) {
+    delete res;
+}
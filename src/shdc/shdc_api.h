@@ -0,0 +1,76 @@
+#pragma once
+/*
+    C API to embed the shader compiler into other tools without going
+    through the filesystem, for instance:
+
+        shdc_setup();
+        const char* args[] = { "--slang", "glsl330:hlsl5:metal_macos" };
+        shdc_result_t* res = shdc_compile(&(shdc_desc_t){
+            .path = "shaders/triangle.glsl",
+            .source = src,
+            .output = "triangle.glsl.h",
+            .args = args,
+            .num_args = 2,
+        });
+        if (shdc_result_success(res)) {
+            for (int i = 0; i < shdc_result_num_outputs(res); i++) {
+                shdc_output_t out = shdc_result_output(res, i);
+                ...
+            }
+        }
+        shdc_result_free(res);
+        shdc_shutdown();
+
+    NOTE: the compiler is not reentrant, shdc_compile() must not be called
+    from multiple threads at the same time.
+*/
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// resolve an include path to file content, return a pointer to the content
+// and write its size to out_size, or return NULL if the file doesn't exist;
+// the content is copied before the callback is called again
+typedef const char* (*shdc_include_func_t)(const char* path, size_t* out_size, void* user_data);
+
+typedef struct shdc_desc_t {
+    const char* path;           // path of the input file, used for error messages and relative includes
+    const char* source;         // optional in-memory source of the input file, otherwise resolved via 'path'
+    const char* output;         // output file path, generated files are named after it, but not written
+    const char** args;          // optional additional command line options (e.g. "--slang", "glsl330")
+    int num_args;
+    shdc_include_func_t include_func;   // optional include resolver, default is the filesystem
+    void* user_data;
+} shdc_desc_t;
+
+typedef struct shdc_output_t {
+    const char* path;
+    const void* data;
+    size_t size;
+} shdc_output_t;
+
+typedef struct shdc_diagnostic_t {
+    bool error;                 // false for warnings
+    const char* file;
+    int line;                   // one-based, 0 if the error is not tied to a line
+    const char* message;
+} shdc_diagnostic_t;
+
+typedef struct shdc_result_t shdc_result_t;
+
+void shdc_setup(void);
+void shdc_shutdown(void);
+shdc_result_t* shdc_compile(const shdc_desc_t* desc);
+bool shdc_result_success(const shdc_result_t* res);
+int shdc_result_num_outputs(const shdc_result_t* res);
+shdc_output_t shdc_result_output(const shdc_result_t* res, int index);
+int shdc_result_num_diagnostics(const shdc_result_t* res);
+shdc_diagnostic_t shdc_result_diagnostic(const shdc_result_t* res, int index);
+void shdc_result_free(shdc_result_t* res);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
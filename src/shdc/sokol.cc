@@ -5,6 +5,9 @@
 #include "fmt/format.h"
 #include "pystring.h"
 #include <stdio.h>
+#include <functional>
+#include <map>
+#include <set>
 
 namespace shdc {
 
@@ -122,18 +125,23 @@ static void write_header(const args_t& args, const input_t& inp, const spirvcros
         assert(vs_src && fs_src);
         L("        Shader program '{}':\n", prog.name);
         L("            Get shader desc: {}{}_shader_desc(sg_query_backend());\n", mod_prefix(inp), prog.name);
+        L("            Get content hash: {}{}_shader_hash(sg_query_backend());\n", mod_prefix(inp), prog.name);
         L("            Vertex shader: {}\n", prog.vs_name);
         L("                Attribute slots:\n");
         const snippet_t& vs_snippet = inp.snippets[vs_src->snippet_index];
         for (const attr_t& attr: vs_src->refl.inputs) {
             if (attr.slot >= 0) {
                 L("                    ATTR_{}{}_{} = {}\n", mod_prefix(inp), vs_snippet.name, attr.name, attr.slot);
+                if ((attr.num_components > 0) && (attr.used_components != ((1u << attr.num_components) - 1))) {
+                    L("                        {}{} with unused components: {}\n", attr_t::base_type_to_str(attr.base_type), attr.num_components, attr.used_components_str());
+                }
             }
         }
         for (const uniform_block_t& ub: vs_src->refl.uniform_blocks) {
             L("                Uniform block '{}':\n", ub.struct_name);
             L("                    C struct: {}{}_t\n", mod_prefix(inp), ub.struct_name);
             L("                    Bind slot: SLOT_{}{} = {}\n", mod_prefix(inp), ub.struct_name, ub.slot);
+            L("                    Active size: {} of {} bytes\n", ub.active_prefix_size, roundup(ub.size, 16));
         }
         for (const image_t& img: vs_src->refl.images) {
             L("                Image '{}':\n", img.name);
@@ -153,10 +161,12 @@ static void write_header(const args_t& args, const input_t& inp, const spirvcros
             L("                    Sampler: {}\n", img_smp.sampler_name);
         }
         L("            Fragment shader: {}\n", prog.fs_name);
+        L("                Early-Z: discard={}, depth write={}, side effects={}, sample rate={}\n", fs_src->refl.uses_discard, fs_src->refl.writes_depth, fs_src->refl.has_side_effects, fs_src->refl.sample_rate);
         for (const uniform_block_t& ub: fs_src->refl.uniform_blocks) {
             L("                Uniform block '{}':\n", ub.struct_name);
             L("                    C struct: {}{}_t\n", mod_prefix(inp), ub.struct_name);
             L("                    Bind slot: SLOT_{}{} = {}\n", mod_prefix(inp), ub.struct_name, ub.slot);
+            L("                    Active size: {} of {} bytes\n", ub.active_prefix_size, roundup(ub.size, 16));
         }
         for (const image_t& img: fs_src->refl.images) {
             L("                Image '{}':\n", img.name);
@@ -240,12 +250,28 @@ static void write_vertex_attrs(const input_t& inp, const spirvcross_t& spirvcros
             for (const attr_t& attr: src.refl.inputs) {
                 if (attr.slot >= 0) {
                     L("#define ATTR_{}{}_{} ({})\n", mod_prefix(inp), vs_snippet.name, attr.name, attr.slot);
+                    if (attr.num_components > 0) {
+                        L("#define ATTR_USED_{}{}_{} ({:#x})\n", mod_prefix(inp), vs_snippet.name, attr.name, attr.used_components);
+                    }
                 }
             }
         }
     }
 }
 
+// fragment shader properties which affect early depth testing
+static void write_fs_flags(const input_t& inp, const spirvcross_t& spirvcross) {
+    for (const spirvcross_source_t& src: spirvcross.sources) {
+        if (src.refl.stage == stage_t::FS) {
+            const snippet_t& fs_snippet = inp.snippets[src.snippet_index];
+            L("#define USES_DISCARD_{}{} ({})\n", mod_prefix(inp), fs_snippet.name, src.refl.uses_discard ? 1 : 0);
+            L("#define WRITES_DEPTH_{}{} ({})\n", mod_prefix(inp), fs_snippet.name, src.refl.writes_depth ? 1 : 0);
+            L("#define HAS_SIDE_EFFECTS_{}{} ({})\n", mod_prefix(inp), fs_snippet.name, src.refl.has_side_effects ? 1 : 0);
+            L("#define SAMPLE_RATE_{}{} ({})\n", mod_prefix(inp), fs_snippet.name, src.refl.sample_rate ? 1 : 0);
+        }
+    }
+}
+
 static void write_image_bind_slots(const input_t& inp, const spirvcross_t& spirvcross) {
     for (const image_t& img: spirvcross.unique_images) {
         L("#define SLOT_{}{} ({})\n", mod_prefix(inp), img.name, img.slot);
@@ -261,6 +287,7 @@ static void write_sampler_bind_slots(const input_t& inp, const spirvcross_t& spi
 static void write_uniform_blocks(const input_t& inp, const spirvcross_t& spirvcross, slang_t::type_t slang) {
     for (const uniform_block_t& ub: spirvcross.unique_uniform_blocks) {
         L("#define SLOT_{}{} ({})\n", mod_prefix(inp), ub.struct_name, ub.slot);
+        L("#define ACTIVE_SIZE_{}{} ({})\n", mod_prefix(inp), ub.struct_name, ub.active_prefix_size);
         L("#pragma pack(push,1)\n");
         int cur_offset = 0;
         L("SOKOL_SHDC_ALIGN(16) typedef struct {}{}_t {{\n", mod_prefix(inp), ub.struct_name);
@@ -316,7 +343,126 @@ static void write_uniform_blocks(const input_t& inp, const spirvcross_t& spirvcr
     }
 }
 
-static void write_common_decls(slang_t::type_t slang, const args_t& args, const input_t& inp, const spirvcross_t& spirvcross) {
+// union of the resources used by the vertex- and fragment-shader of a program,
+// these define the integer ids of the --reflection by-id functions
+struct prog_resources_t {
+    const spirvcross_source_t* src[2] = { };
+    std::vector<const attr_t*> attrs;
+    std::vector<const image_t*> images;
+    std::vector<const sampler_t*> samplers;
+    std::vector<const uniform_block_t*> uniform_blocks;
+    std::vector<std::pair<const uniform_block_t*, const uniform_t*>> uniforms;
+};
+
+static prog_resources_t gather_prog_resources(const program_t& prog, const input_t& inp, const spirvcross_t& spirvcross) {
+    prog_resources_t res;
+    res.src[0] = find_spirvcross_source_by_shader_name(prog.vs_name, inp, spirvcross);
+    res.src[1] = find_spirvcross_source_by_shader_name(prog.fs_name, inp, spirvcross);
+    assert(res.src[0] && res.src[1]);
+    for (const attr_t& attr: res.src[0]->refl.inputs) {
+        if (attr.slot >= 0) {
+            res.attrs.push_back(&attr);
+        }
+    }
+    std::set<std::string> img_names, smp_names, ub_names;
+    for (const spirvcross_source_t* src: res.src) {
+        for (const image_t& img: src->refl.images) {
+            if ((img.slot >= 0) && img_names.insert(img.name).second) {
+                res.images.push_back(&img);
+            }
+        }
+        for (const sampler_t& smp: src->refl.samplers) {
+            if ((smp.slot >= 0) && smp_names.insert(smp.name).second) {
+                res.samplers.push_back(&smp);
+            }
+        }
+        for (const uniform_block_t& ub: src->refl.uniform_blocks) {
+            if ((ub.slot >= 0) && ub_names.insert(ub.struct_name).second) {
+                res.uniform_blocks.push_back(&ub);
+                for (const uniform_t& u: ub.uniforms) {
+                    res.uniforms.push_back({ &ub, &u });
+                }
+            }
+        }
+    }
+    return res;
+}
+
+/* The enumerators are named [prefix]_[kind]_id_[name], the '_id_' separates
+   them from the --reflection lookup functions (e.g. an attribute named 'slot'
+   vs [prefix]_attr_slot()). Remaining collisions (uniform ids 'a_b'+'c' vs
+   'a'+'b_c', or a resource named 't' vs the enum type name) are reported as
+   error.
+*/
+static errmsg_t write_id_enum(const input_t& inp, const std::string& prefix, const char* kind, const std::vector<std::string>& names) {
+    const std::string type_name = fmt::format("{}_{}_id_t", prefix, kind);
+    std::set<std::string> enumerators = { type_name };
+    for (const std::string& name: names) {
+        const std::string enumerator = fmt::format("{}_{}_id_{}", prefix, kind, name);
+        if (!enumerators.insert(enumerator).second) {
+            return errmsg_t::error(inp.base_path, 0, fmt::format("reflection id '{}' is not unique, please rename the {}", enumerator, kind));
+        }
+    }
+    L("typedef enum {} {{\n", type_name);
+    for (int i = 0; i < (int)names.size(); i++) {
+        L("    {}_{}_id_{} = {},\n", prefix, kind, names[i], i);
+    }
+    L("    {}_num_{}s = {},\n", prefix, kind, names.size());
+    L("}} {};\n", type_name);
+    return errmsg_t();
+}
+
+static errmsg_t write_reflection_ids(const input_t& inp, const spirvcross_t& spirvcross) {
+    for (const auto& item: inp.programs) {
+        const program_t& prog = item.second;
+        const prog_resources_t res = gather_prog_resources(prog, inp, spirvcross);
+        const std::string prefix = fmt::format("{}{}", mod_prefix(inp), prog.name);
+        std::vector<std::string> names;
+        errmsg_t err;
+        for (const attr_t* attr: res.attrs) {
+            names.push_back(attr->name);
+        }
+        err = write_id_enum(inp, prefix, "attr", names);
+        if (err.valid) {
+            return err;
+        }
+        names.clear();
+        for (const image_t* img: res.images) {
+            names.push_back(img->name);
+        }
+        err = write_id_enum(inp, prefix, "image", names);
+        if (err.valid) {
+            return err;
+        }
+        names.clear();
+        for (const sampler_t* smp: res.samplers) {
+            names.push_back(smp->name);
+        }
+        err = write_id_enum(inp, prefix, "sampler", names);
+        if (err.valid) {
+            return err;
+        }
+        names.clear();
+        for (const uniform_block_t* ub: res.uniform_blocks) {
+            names.push_back(ub->struct_name);
+        }
+        err = write_id_enum(inp, prefix, "uniformblock", names);
+        if (err.valid) {
+            return err;
+        }
+        names.clear();
+        for (const auto& u: res.uniforms) {
+            names.push_back(fmt::format("{}_{}", u.first->struct_name, u.second->name));
+        }
+        err = write_id_enum(inp, prefix, "uniform", names);
+        if (err.valid) {
+            return err;
+        }
+    }
+    return errmsg_t();
+}
+
+static errmsg_t write_common_decls(slang_t::type_t slang, const args_t& args, const input_t& inp, const spirvcross_t& spirvcross) {
     if (args.output_format == format_t::SOKOL_IMPL) {
         L("#if !defined(SOKOL_GFX_INCLUDED)\n");
         L("  #error \"Please include sokol_gfx.h before {}\"\n", pystring::os::path::basename(args.output));
@@ -329,35 +475,163 @@ static void write_common_decls(slang_t::type_t slang, const args_t& args, const
     L("    #define SOKOL_SHDC_ALIGN(a) __attribute__((aligned(a)))\n");
     L("  #endif\n");
     L("#endif\n");
+    // designated initializers in C++ require C++20, older C++ versions
+    // fall back to initializing the shader desc on first use
+    L("#if !defined(SOKOL_SHDC_STATIC_DESC)\n");
+    L("  #if !defined(__cplusplus) || (__cplusplus >= 202002L) || (defined(_MSVC_LANG) && (_MSVC_LANG >= 202002L))\n");
+    L("    #define SOKOL_SHDC_STATIC_DESC (1)\n");
+    L("  #else\n");
+    L("    #define SOKOL_SHDC_STATIC_DESC (0)\n");
+    L("  #endif\n");
+    L("#endif\n");
+    if (args.reflection) {
+        errmsg_t err = write_reflection_ids(inp, spirvcross);
+        if (err.valid) {
+            return err;
+        }
+    }
     if (args.output_format == format_t::SOKOL_IMPL) {
         for (const auto& item: inp.programs) {
             const program_t& prog = item.second;
             L("const sg_shader_desc* {}{}_shader_desc(sg_backend backend);\n", mod_prefix(inp), prog.name);
+            L("uint64_t {}{}_shader_hash(sg_backend backend);\n", mod_prefix(inp), prog.name);
             if (args.reflection) {
                 L("int {}{}_attr_slot(const char* attr_name);\n", mod_prefix(inp), prog.name);
                 L("int {}{}_image_slot(sg_shader_stage stage, const char* img_name);\n", mod_prefix(inp), prog.name);
                 L("int {}{}_sampler_slot(sg_shader_stage stage, const char* smp_name);\n", mod_prefix(inp), prog.name);
                 L("int {}{}_uniformblock_slot(sg_shader_stage stage, const char* ub_name);\n", mod_prefix(inp), prog.name);
                 L("size_t {}{}_uniformblock_size(sg_shader_stage stage, const char* ub_name);\n", mod_prefix(inp), prog.name);
+                L("size_t {}{}_uniformblock_active_size(sg_shader_stage stage, const char* ub_name);\n", mod_prefix(inp), prog.name);
                 L("int {}{}_uniform_offset(sg_shader_stage stage, const char* ub_name, const char* u_name);\n", mod_prefix(inp), prog.name);
                 L("sg_shader_uniform_desc {}{}_uniform_desc(sg_shader_stage stage, const char* ub_name, const char* u_name);\n", mod_prefix(inp), prog.name);
+                const prog_resources_t res = gather_prog_resources(prog, inp, spirvcross);
+                const std::string prefix = fmt::format("{}{}", mod_prefix(inp), prog.name);
+                if (!res.attrs.empty()) {
+                    L("int {}_attr_slot_by_id({}_attr_id_t id);\n", prefix, prefix);
+                }
+                if (!res.images.empty()) {
+                    L("int {}_image_slot_by_id(sg_shader_stage stage, {}_image_id_t id);\n", prefix, prefix);
+                }
+                if (!res.samplers.empty()) {
+                    L("int {}_sampler_slot_by_id(sg_shader_stage stage, {}_sampler_id_t id);\n", prefix, prefix);
+                }
+                if (!res.uniform_blocks.empty()) {
+                    L("int {}_uniformblock_slot_by_id(sg_shader_stage stage, {}_uniformblock_id_t id);\n", prefix, prefix);
+                    L("size_t {}_uniformblock_size_by_id(sg_shader_stage stage, {}_uniformblock_id_t id);\n", prefix, prefix);
+                }
+                if (!res.uniforms.empty()) {
+                    L("int {}_uniform_offset_by_id(sg_shader_stage stage, {}_uniform_id_t id);\n", prefix, prefix);
+                }
             }
         }
     }
     write_vertex_attrs(inp, spirvcross);
+    write_fs_flags(inp, spirvcross);
     write_image_bind_slots(inp, spirvcross);
     write_sampler_bind_slots(inp, spirvcross);
     write_uniform_blocks(inp, spirvcross, slang);
+    return errmsg_t();
+}
+
+// sidecar files for --embed=embed, written next to the output header
+static std::vector<std::pair<std::string, std::vector<uint8_t>>> sidecar_files;
+
+// MSVC rejects string literals longer than 64 KBytes after concatenation,
+// bigger arrays fall back to hex bytes in --embed=string mode
+static const size_t max_string_literal_size = 0xFFFF;
+
+static void write_bytes_array(const char* c_type, const std::string& c_name, const uint8_t* ptr, size_t len) {
+    L("static const {} {}[{}] = {{\n", c_type, c_name, len);
+    for (size_t i = 0; i < len; i++) {
+        if ((i & 15) == 0) {
+            L("    ");
+        }
+        L("{:#04x},", ptr[i]);
+        if ((i & 15) == 15) {
+            L("\n");
+        }
+    }
+    L("\n}};\n");
+}
+
+/* write data as a sequence of string literal chunks, the array is declared one
+   byte bigger than the data because C++ requires room for the terminating
+   zero of the string literal (for sources this is the trailing zero anyway)
+*/
+static void write_string_array(const char* c_type, const std::string& c_name, const uint8_t* ptr, size_t len) {
+    L("static const {} {}[{}] =\n", c_type, c_name, len + 1);
+    std::string chunk;
+    for (size_t i = 0; i < len; i++) {
+        const uint8_t c = ptr[i];
+        switch (c) {
+            case '\n': chunk += "\\n"; break;
+            case '\t': chunk += "\\t"; break;
+            case '"':  chunk += "\\\""; break;
+            case '\\': chunk += "\\\\"; break;
+            case '?':  chunk += "\\?"; break;    // avoid accidental trigraphs
+            default:
+                if ((c >= 0x20) && (c < 0x7F)) {
+                    chunk += (char)c;
+                }
+                else {
+                    // always 3 octal digits, so that a following digit isn't swallowed
+                    chunk += fmt::format("\\{:03o}", c);
+                }
+                break;
+        }
+        if ((c == '\n') || (chunk.length() >= 96) || (i == (len - 1))) {
+            L("    \"{}\"\n", chunk);
+            chunk.clear();
+        }
+    }
+    if (len == 0) {
+        L("    \"\"\n");
+    }
+    L(";\n");
+}
+
+static void write_embed_array(const args_t& args, const char* c_type, const std::string& c_name, const uint8_t* ptr, size_t len) {
+    std::string out_dir, out_filename;
+    pystring::os::path::split(out_dir, out_filename, args.output);
+    const std::string sidecar_filename = fmt::format("{}.{}.bin", out_filename, c_name);
+    sidecar_files.push_back({ pystring::os::path::join(out_dir, sidecar_filename), std::vector<uint8_t>(ptr, ptr + len) });
+    L("static const {} {}[{}] = {{\n", c_type, c_name, len);
+    L("#embed \"{}\"\n", sidecar_filename);
+    L("}};\n");
+}
+
+/* if zero_terminated is true, the last of the len bytes is a terminating zero
+   which is provided by the literal itself in --embed=string mode, but must
+   be written explicitly for all other array forms
+*/
+static void write_data_array(const args_t& args, const char* c_type, const std::string& c_name, const uint8_t* ptr, size_t len, bool zero_terminated) {
+    switch (args.embed) {
+        case embed_t::STRING:
+            if (len < max_string_literal_size) {
+                write_string_array(c_type, c_name, ptr, zero_terminated ? (len - 1) : len);
+            }
+            else {
+                write_bytes_array(c_type, c_name, ptr, len);
+            }
+            break;
+        case embed_t::EMBED:
+            write_embed_array(args, c_type, c_name, ptr, len);
+            break;
+        default:
+            write_bytes_array(c_type, c_name, ptr, len);
+            break;
+    }
 }
 
-static void write_shader_sources_and_blobs(const input_t& inp,
+static void write_shader_sources_and_blobs(const args_t& args,
+                                           const input_t& inp,
                                            const spirvcross_t& spirvcross,
                                            const bytecode_t& bytecode,
                                            slang_t::type_t slang)
 {
     for (int snippet_index = 0; snippet_index < (int)inp.snippets.size(); snippet_index++) {
         const snippet_t& snippet = inp.snippets[snippet_index];
-        if ((snippet.type != snippet_t::VS) && (snippet.type != snippet_t::FS)) {
+        if (((snippet.type != snippet_t::VS) && (snippet.type != snippet_t::FS)) || snippet.specialized_only) {
             continue;
         }
         int src_index = spirvcross.find_source_by_snippet_index(snippet_index);
@@ -378,52 +652,66 @@ static void write_shader_sources_and_blobs(const input_t& inp,
         L("*/\n");
         if (blob) {
             std::string c_name = fmt::format("{}{}_bytecode_{}", mod_prefix(inp), snippet.name, slang_t::to_str(slang));
-            L("static const uint8_t {}[{}] = {{\n", c_name.c_str(), blob->data.size());
-            const size_t len = blob->data.size();
-            for (size_t i = 0; i < len; i++) {
-                if ((i & 15) == 0) {
-                    L("    ");
-                }
-                L("{:#04x},", blob->data[i]);
-                if ((i & 15) == 15) {
-                    L("\n");
-                }
-            }
-            L("\n}};\n");
+            write_data_array(args, "uint8_t", c_name, blob->data.data(), blob->data.size(), false);
         }
         else {
             /* if no bytecode exists, write the source code, but also a byte array with a trailing 0 */
             std::string c_name = fmt::format("{}{}_source_{}", mod_prefix(inp), snippet.name, slang_t::to_str(slang));
-            const size_t len = src.source_code.length() + 1;
-            L("static const char {}[{}] = {{\n", c_name.c_str(), len);
-            for (size_t i = 0; i < len; i++) {
-                if ((i & 15) == 0) {
-                    L("    ");
-                }
-                L("{:#04x},", src.source_code[i]);
-                if ((i & 15) == 15) {
-                    L("\n");
-                }
-            }
-            L("\n}};\n");
+            const uint8_t* ptr = (const uint8_t*) src.source_code.c_str();
+            write_data_array(args, "char", c_name, ptr, src.source_code.length() + 1, true);
         }
     }
 }
 
-static void write_stage(const char* indent,
-                        const char* stage_name,
-                        const spirvcross_source_t* src,
-                        const std::string& src_name,
-                        const bytecode_blob_t* blob,
-                        const std::string& blob_name,
-                        slang_t::type_t slang)
+/* The fields of a generated sg_shader_desc are gathered once into a tree,
+   which is then written either as a static initializer or as a sequence of
+   assignments, so that both forms always agree. The static initializer only
+   uses the subset of designated initializers which is valid in both C99 and
+   C++20: field designators in declaration order, and positional array items
+   with {0} for unused slots. Fields must be added in declaration order, and
+   array items in ascending index order.
+*/
+struct desc_field_t {
+    std::string name;                   // struct field name, empty for array items
+    int index = -1;                     // array item index, -1 for struct fields
+    std::string value;                  // C expression of leaf fields
+    std::vector<desc_field_t> fields;   // struct fields or array items
+};
+
+static desc_field_t& add_field(desc_field_t& parent, const std::string& name, const std::string& value = std::string()) {
+    desc_field_t field;
+    field.name = name;
+    field.value = value;
+    parent.fields.push_back(field);
+    return parent.fields.back();
+}
+
+static desc_field_t& add_item(desc_field_t& parent, int index) {
+    desc_field_t item;
+    item.index = index;
+    parent.fields.push_back(item);
+    return parent.fields.back();
+}
+
+static void gather_stage_desc(desc_field_t& desc,
+                              const char* stage_name,
+                              const spirvcross_source_t* src,
+                              const std::string& src_name,
+                              const bytecode_blob_t* blob,
+                              const std::string& blob_name,
+                              slang_t::type_t slang)
 {
+    desc_field_t& stage = add_field(desc, stage_name);
     if (blob) {
-        L("{}desc.{}.bytecode.ptr = {};\n", indent, stage_name, blob_name);
-        L("{}desc.{}.bytecode.size = {};\n", indent, stage_name, blob->data.size());
+        desc_field_t& bytecode = add_field(stage, "bytecode");
+        add_field(bytecode, "ptr", blob_name);
+        add_field(bytecode, "size", fmt::format("{}", blob->data.size()));
     }
     else {
-        L("{}desc.{}.source = {};\n", indent, stage_name, src_name);
+        add_field(stage, "source", src_name);
+    }
+    add_field(stage, "entry", fmt::format("\"{}\"", src->refl.entry_point));
+    if (!blob) {
         const char* d3d11_tgt = nullptr;
         if (slang == slang_t::HLSL4) {
             d3d11_tgt = (0 == strcmp("vs", stage_name)) ? "vs_4_0" : "ps_4_0";
@@ -432,98 +720,155 @@ static void write_stage(const char* indent,
             d3d11_tgt = (0 == strcmp("vs", stage_name)) ? "vs_5_0" : "ps_5_0";
         }
         if (d3d11_tgt) {
-            L("{}desc.{}.d3d11_target = \"{}\";\n", indent, stage_name, d3d11_tgt);
+            add_field(stage, "d3d11_target", fmt::format("\"{}\"", d3d11_tgt));
         }
     }
-    L("{}desc.{}.entry = \"{}\";\n", indent, stage_name, src->refl.entry_point);
+    desc_field_t ubs;
     for (int ub_index = 0; ub_index < uniform_block_t::NUM; ub_index++) {
         const uniform_block_t* ub = find_uniform_block_by_slot(src->refl, ub_index);
         if (ub) {
-            L("{}desc.{}.uniform_blocks[{}].size = {};\n", indent, stage_name, ub_index, roundup(ub->size, 16));
-            L("{}desc.{}.uniform_blocks[{}].layout = SG_UNIFORMLAYOUT_STD140;\n", indent, stage_name, ub_index);
+            desc_field_t& ub_desc = add_item(ubs, ub_index);
+            add_field(ub_desc, "size", fmt::format("{}", roundup(ub->size, 16)));
+            add_field(ub_desc, "layout", "SG_UNIFORMLAYOUT_STD140");
             if (slang_t::is_glsl(slang) && (ub->uniforms.size() > 0)) {
+                desc_field_t& uniforms = add_field(ub_desc, "uniforms");
                 if (ub->flattened) {
-                    L("{}desc.{}.uniform_blocks[{}].uniforms[0].name = \"{}\";\n", indent, stage_name, ub_index, ub->struct_name);
-                    L("{}desc.{}.uniform_blocks[{}].uniforms[0].type = {};\n", indent, stage_name, ub_index, uniform_type_to_flattened_sokol_type_str(ub->uniforms[0].type));
-                    L("{}desc.{}.uniform_blocks[{}].uniforms[0].array_count = {};\n", indent, stage_name, ub_index, roundup(ub->size, 16) / 16);
+                    desc_field_t& u_desc = add_item(uniforms, 0);
+                    add_field(u_desc, "name", fmt::format("\"{}\"", ub->struct_name));
+                    add_field(u_desc, "type", uniform_type_to_flattened_sokol_type_str(ub->uniforms[0].type));
+                    add_field(u_desc, "array_count", fmt::format("{}", roundup(ub->size, 16) / 16));
                 }
                 else {
                     for (int u_index = 0; u_index < (int)ub->uniforms.size(); u_index++) {
                         const uniform_t& u = ub->uniforms[u_index];
-                        L("{}desc.{}.uniform_blocks[{}].uniforms[{}].name = \"{}.{}\";\n", indent, stage_name, ub_index, u_index, ub->inst_name, u.name);
-                        L("{}desc.{}.uniform_blocks[{}].uniforms[{}].type = {};\n", indent, stage_name, ub_index, u_index, uniform_type_to_sokol_type_str(u.type));
-                        L("{}desc.{}.uniform_blocks[{}].uniforms[{}].array_count = {};\n", indent, stage_name, ub_index, u_index, u.array_count);
+                        desc_field_t& u_desc = add_item(uniforms, u_index);
+                        add_field(u_desc, "name", fmt::format("\"{}.{}\"", ub->inst_name, u.name));
+                        add_field(u_desc, "type", uniform_type_to_sokol_type_str(u.type));
+                        add_field(u_desc, "array_count", fmt::format("{}", u.array_count));
                     }
                 }
             }
         }
     }
+    if (!ubs.fields.empty()) {
+        add_field(stage, "uniform_blocks").fields = std::move(ubs.fields);
+    }
+    desc_field_t imgs;
     for (int img_index = 0; img_index < image_t::NUM; img_index++) {
         const image_t* img = find_image_by_slot(src->refl, img_index);
         if (img) {
-            L("{}desc.{}.images[{}].used = true;\n", indent, stage_name, img_index);
-            L("{}desc.{}.images[{}].multisampled = {};\n", indent, stage_name, img_index, img->multisampled ? "true" : "false");
-            L("{}desc.{}.images[{}].image_type = {};\n", indent, stage_name, img_index, img_type_to_sokol_type_str(img->type));
-            L("{}desc.{}.images[{}].sample_type = {};\n", indent, stage_name, img_index, img_basetype_to_sokol_sampletype_str(img->sample_type));
+            desc_field_t& img_desc = add_item(imgs, img_index);
+            add_field(img_desc, "used", "true");
+            add_field(img_desc, "multisampled", img->multisampled ? "true" : "false");
+            add_field(img_desc, "image_type", img_type_to_sokol_type_str(img->type));
+            add_field(img_desc, "sample_type", img_basetype_to_sokol_sampletype_str(img->sample_type));
         }
     }
+    if (!imgs.fields.empty()) {
+        add_field(stage, "images").fields = std::move(imgs.fields);
+    }
+    desc_field_t smps;
     for (int smp_index = 0; smp_index < sampler_t::NUM; smp_index++) {
         const sampler_t* smp = find_sampler_by_slot(src->refl, smp_index);
         if (smp) {
-            L("{}desc.{}.samplers[{}].used = true;\n", indent, stage_name, smp_index);
-            L("{}desc.{}.samplers[{}].sampler_type = {};\n", indent, stage_name, smp_index, smp_type_to_sokol_type_str(smp->type));
+            desc_field_t& smp_desc = add_item(smps, smp_index);
+            add_field(smp_desc, "used", "true");
+            add_field(smp_desc, "sampler_type", smp_type_to_sokol_type_str(smp->type));
         }
     }
+    if (!smps.fields.empty()) {
+        add_field(stage, "samplers").fields = std::move(smps.fields);
+    }
+    desc_field_t img_smps;
     for (int img_smp_index = 0; img_smp_index < image_sampler_t::NUM; img_smp_index++) {
         const image_sampler_t* img_smp = find_image_sampler_by_slot(src->refl, img_smp_index);
         if (img_smp) {
-            L("{}desc.{}.image_sampler_pairs[{}].used = true;\n", indent, stage_name, img_smp_index);
-            L("{}desc.{}.image_sampler_pairs[{}].image_slot = {};\n", indent, stage_name, img_smp_index, find_image_by_name(src->refl, img_smp->image_name)->slot);
-            L("{}desc.{}.image_sampler_pairs[{}].sampler_slot = {};\n", indent, stage_name, img_smp_index, find_sampler_by_name(src->refl, img_smp->sampler_name)->slot);
+            desc_field_t& img_smp_desc = add_item(img_smps, img_smp_index);
+            add_field(img_smp_desc, "used", "true");
+            add_field(img_smp_desc, "image_slot", fmt::format("{}", find_image_by_name(src->refl, img_smp->image_name)->slot));
+            add_field(img_smp_desc, "sampler_slot", fmt::format("{}", find_sampler_by_name(src->refl, img_smp->sampler_name)->slot));
             if (slang_t::is_glsl(slang)) {
-                L("{}desc.{}.image_sampler_pairs[{}].glsl_name = \"{}\";\n", indent, stage_name, img_smp_index, img_smp->name);
+                add_field(img_smp_desc, "glsl_name", fmt::format("\"{}\"", img_smp->name));
             }
         }
     }
+    if (!img_smps.fields.empty()) {
+        add_field(stage, "image_sampler_pairs").fields = std::move(img_smps.fields);
+    }
 }
 
-static void write_shader_desc_init(const char* indent, const program_t& prog, const input_t& inp, const spirvcross_t& spirvcross, const bytecode_t& bytecode, slang_t::type_t slang) {
+static desc_field_t gather_shader_desc(const program_t& prog, const input_t& inp, const spirvcross_t& spirvcross, const bytecode_t& bytecode, slang_t::type_t slang) {
     const spirvcross_source_t* vs_src = find_spirvcross_source_by_shader_name(prog.vs_name, inp, spirvcross);
     const spirvcross_source_t* fs_src = find_spirvcross_source_by_shader_name(prog.fs_name, inp, spirvcross);
     assert(vs_src && fs_src);
     const bytecode_blob_t* vs_blob = find_bytecode_blob_by_shader_name(prog.vs_name, inp, bytecode);
     const bytecode_blob_t* fs_blob = find_bytecode_blob_by_shader_name(prog.fs_name, inp, bytecode);
-    std::string vs_src_name, fs_src_name;
-    std::string vs_blob_name, fs_blob_name;
-    if (vs_blob) {
-        vs_blob_name = fmt::format("{}{}_bytecode_{}", mod_prefix(inp), prog.vs_name, slang_t::to_str(slang));
-    }
-    else {
-        vs_src_name = fmt::format("{}{}_source_{}", mod_prefix(inp), prog.vs_name, slang_t::to_str(slang));
-    }
-    if (fs_blob) {
-        fs_blob_name = fmt::format("{}{}_bytecode_{}", mod_prefix(inp), prog.fs_name, slang_t::to_str(slang));
-    }
-    else {
-        fs_src_name = fmt::format("{}{}_source_{}", mod_prefix(inp), prog.fs_name, slang_t::to_str(slang));
-    }
+    const std::string vs_src_name = fmt::format("{}{}_source_{}", mod_prefix(inp), prog.vs_name, slang_t::to_str(slang));
+    const std::string fs_src_name = fmt::format("{}{}_source_{}", mod_prefix(inp), prog.fs_name, slang_t::to_str(slang));
+    const std::string vs_blob_name = fmt::format("{}{}_bytecode_{}", mod_prefix(inp), prog.vs_name, slang_t::to_str(slang));
+    const std::string fs_blob_name = fmt::format("{}{}_bytecode_{}", mod_prefix(inp), prog.fs_name, slang_t::to_str(slang));
 
-    /* write shader desc */
+    desc_field_t desc;
+    desc_field_t attrs;
     for (int attr_index = 0; attr_index < attr_t::NUM; attr_index++) {
         const attr_t& attr = vs_src->refl.inputs[attr_index];
         if (attr.slot >= 0) {
             if (slang_t::is_glsl(slang)) {
-                L("{}desc.attrs[{}].name = \"{}\";\n", indent, attr_index, attr.name);
+                desc_field_t& attr_desc = add_item(attrs, attr_index);
+                add_field(attr_desc, "name", fmt::format("\"{}\"", attr.name));
             }
             else if (slang_t::is_hlsl(slang)) {
-                L("{}desc.attrs[{}].sem_name = \"{}\";\n", indent, attr_index, attr.sem_name);
-                L("{}desc.attrs[{}].sem_index = {};\n", indent, attr_index, attr.sem_index);
+                desc_field_t& attr_desc = add_item(attrs, attr_index);
+                add_field(attr_desc, "sem_name", fmt::format("\"{}\"", attr.sem_name));
+                add_field(attr_desc, "sem_index", fmt::format("{}", attr.sem_index));
+            }
+        }
+    }
+    if (!attrs.fields.empty()) {
+        add_field(desc, "attrs").fields = std::move(attrs.fields);
+    }
+    gather_stage_desc(desc, "vs", vs_src, vs_src_name, vs_blob, vs_blob_name, slang);
+    gather_stage_desc(desc, "fs", fs_src, fs_src_name, fs_blob, fs_blob_name, slang);
+    add_field(desc, "label", fmt::format("\"{}{}_shader\"", mod_prefix(inp), prog.name));
+    return desc;
+}
+
+// write the desc as assignments to the fields of a 'desc' variable
+static void write_desc_assignments(const std::string& indent, const std::string& path, const desc_field_t& node) {
+    for (const desc_field_t& field: node.fields) {
+        const std::string field_path = (field.index >= 0) ? fmt::format("{}[{}]", path, field.index) : fmt::format("{}.{}", path, field.name);
+        if (field.fields.empty()) {
+            L("{}{} = {};\n", indent, field_path, field.value);
+        }
+        else {
+            write_desc_assignments(indent, field_path, field);
+        }
+    }
+}
+
+// write the content of a struct or array initializer
+static void write_desc_initializer(const std::string& indent, const desc_field_t& node) {
+    int next_index = 0;
+    for (const desc_field_t& field: node.fields) {
+        std::string designator;
+        if (field.index >= 0) {
+            for (; next_index < field.index; next_index++) {
+                L("{}{{0}},\n", indent);
             }
+            next_index++;
+        }
+        else {
+            designator = fmt::format(".{} = ", field.name);
+        }
+        if (field.fields.empty()) {
+            L("{}{}{},\n", indent, designator, field.value);
+        }
+        else {
+            L("{}{}{{\n", indent, designator);
+            write_desc_initializer(indent + "  ", field);
+            L("{}}},\n", indent);
         }
     }
-    write_stage(indent, "vs", vs_src, vs_src_name, vs_blob, vs_blob_name, slang);
-    write_stage(indent, "fs", fs_src, fs_src_name, fs_blob, fs_blob_name, slang);
-    L("{}desc.label = \"{}{}_shader\";\n", indent, mod_prefix(inp), prog.name);
 }
 
 static std::string func_prefix(const args_t& args) {
@@ -546,13 +891,20 @@ static void write_shader_desc_func(const program_t& prog, const args_t& args, co
             if (args.ifdef) {
                 L("  #if defined({})\n", sokol_define(slang));
             }
+            const desc_field_t desc = gather_shader_desc(prog, inp, spirvcross[i], bytecode[i], slang);
             L("  if (backend == {}) {{\n", sokol_backend(slang));
+            L("    #if SOKOL_SHDC_STATIC_DESC\n");
+            L("    static const sg_shader_desc desc = {{\n");
+            write_desc_initializer("      ", desc);
+            L("    }};\n");
+            L("    #else\n");
             L("    static sg_shader_desc desc;\n");
             L("    static bool valid;\n");
             L("    if (!valid) {{\n");
             L("      valid = true;\n");
-            write_shader_desc_init("      ", prog, inp, spirvcross[i], bytecode[i], slang);
+            write_desc_assignments("      ", "desc", desc);
             L("    }}\n");
+            L("    #endif\n");
             L("    return &desc;\n");
             L("  }}\n");
             if (args.ifdef) {
@@ -564,41 +916,136 @@ static void write_shader_desc_func(const program_t& prog, const args_t& args, co
     L("}}\n");
 }
 
+static void write_shader_hash_func(const program_t& prog, const args_t& args, const input_t& inp,
+                                   const std::array<spirvcross_t,slang_t::NUM>& spirvcross,
+                                   const std::array<bytecode_t,slang_t::NUM>& bytecode)
+{
+    L("{}uint64_t {}{}_shader_hash(sg_backend backend) {{\n", func_prefix(args), mod_prefix(inp), prog.name);
+    for (int i = 0; i < slang_t::NUM; i++) {
+        slang_t::type_t slang = (slang_t::type_t) i;
+        if (args.slang & slang_t::bit(slang)) {
+            if (args.ifdef) {
+                L("  #if defined({})\n", sokol_define(slang));
+            }
+            L("  if (backend == {}) {{\n", sokol_backend(slang));
+            L("    return 0x{:016X}ULL;\n", program_hash(prog, inp, spirvcross[i], bytecode[i], slang));
+            L("  }}\n");
+            if (args.ifdef) {
+                L("  #endif /* {} */\n", sokol_define(slang));
+            }
+        }
+    }
+    L("  return 0;\n");
+    L("}}\n");
+}
+
+typedef std::function<void(const std::string& indent)> name_case_body_t;
+typedef std::vector<std::pair<std::string, name_case_body_t>> name_cases_t;
+
+// find the character position which best separates names of the same length
+static int find_char_pos(const name_cases_t& cases, const std::vector<int>& indices, size_t len) {
+    int best_pos = -1;
+    size_t best_count = 1;
+    for (size_t pos = 0; pos < len; pos++) {
+        std::set<char> chars;
+        for (int i: indices) {
+            chars.insert(cases[i].first[pos]);
+        }
+        if (chars.size() > best_count) {
+            best_pos = (int)pos;
+            best_count = chars.size();
+            if (best_count == indices.size()) {
+                break;
+            }
+        }
+    }
+    return best_pos;
+}
+
+static void write_name_cases(const std::string& indent, const char* var_name, const name_cases_t& cases, const std::vector<int>& indices) {
+    for (int i: indices) {
+        L("{}if (0 == strcmp({}, \"{}\")) {{\n", indent, var_name, cases[i].first);
+        cases[i].second(indent + "  ");
+        L("{}}}\n", indent);
+    }
+}
+
+/* Write a name lookup as a switch over the string length and the character
+   position which best separates all names of the same length, so that
+   usually only one strcmp() is needed to verify a match. The body callbacks
+   must not fall through (e.g. end with a return statement).
+*/
+static void write_name_switch(const std::string& indent, const char* var_name, const name_cases_t& cases) {
+    if (cases.empty()) {
+        return;
+    }
+    std::map<size_t, std::vector<int>> by_length;
+    for (int i = 0; i < (int)cases.size(); i++) {
+        by_length[cases[i].first.length()].push_back(i);
+    }
+    L("{}switch (strlen({})) {{\n", indent, var_name);
+    for (const auto& item: by_length) {
+        const size_t len = item.first;
+        const std::vector<int>& indices = item.second;
+        const std::string ind = indent + "    ";
+        L("{}  case {}:\n", indent, len);
+        const int pos = (indices.size() > 1) ? find_char_pos(cases, indices, len) : -1;
+        if (pos < 0) {
+            write_name_cases(ind, var_name, cases, indices);
+        }
+        else {
+            std::map<char, std::vector<int>> by_char;
+            for (int i: indices) {
+                by_char[cases[i].first[pos]].push_back(i);
+            }
+            L("{}switch ({}[{}]) {{\n", ind, var_name, pos);
+            for (const auto& char_item: by_char) {
+                L("{}  case '{}':\n", ind, char_item.first);
+                write_name_cases(ind + "    ", var_name, cases, char_item.second);
+                L("{}    break;\n", ind);
+            }
+            L("{}}}\n", ind);
+        }
+        L("{}break;\n", ind);
+    }
+    L("{}}}\n", indent);
+}
+
 static void write_attr_slot_func(const program_t& prog, const args_t& args, const input_t& inp, const spirvcross_t& spirvcross) {
     const spirvcross_source_t* vs_src = find_spirvcross_source_by_shader_name(prog.vs_name, inp, spirvcross);
     assert(vs_src);
 
     L("{}int {}{}_attr_slot(const char* attr_name) {{\n", func_prefix(args), mod_prefix(inp), prog.name);
     L("  (void)attr_name;\n");
+    name_cases_t cases;
     for (const attr_t& attr: vs_src->refl.inputs) {
         if (attr.slot >= 0) {
-            L("  if (0 == strcmp(attr_name, \"{}\")) {{\n", attr.name);
-            L("    return {};\n", attr.slot);
-            L("  }}\n");
+            cases.push_back({ attr.name, [&attr](const std::string& ind) { L("{}return {};\n", ind, attr.slot); } });
         }
     }
+    write_name_switch("  ", "attr_name", cases);
     L("  return -1;\n");
     L("}}\n");
 }
 
 static void write_image_slot_stage(const spirvcross_source_t* src) {
+    name_cases_t cases;
     for (const image_t& img: src->refl.images) {
         if (img.slot >= 0) {
-            L("    if (0 == strcmp(img_name, \"{}\")) {{\n", img.name);
-            L("      return {};\n", img.slot);
-            L("    }}\n");
+            cases.push_back({ img.name, [&img](const std::string& ind) { L("{}return {};\n", ind, img.slot); } });
         }
     }
+    write_name_switch("    ", "img_name", cases);
 }
 
 static void write_sampler_slot_stage(const spirvcross_source_t* src) {
+    name_cases_t cases;
     for (const sampler_t& smp: src->refl.samplers) {
         if (smp.slot >= 0) {
-            L("    if (0 == strcmp(smp_name, \"{}\")) {{\n", smp.name);
-            L("      return {};\n", smp.slot);
-            L("    }}\n");
+            cases.push_back({ smp.name, [&smp](const std::string& ind) { L("{}return {};\n", ind, smp.slot); } });
         }
     }
+    write_name_switch("    ", "smp_name", cases);
 }
 
 static void write_image_slot_func(const program_t& prog, const args_t& args, const input_t& inp, const spirvcross_t& spirvcross) {
@@ -644,13 +1091,13 @@ static void write_sampler_slot_func(const program_t& prog, const args_t& args, c
 }
 
 static void write_uniformblock_slot_stage(const spirvcross_source_t* src) {
+    name_cases_t cases;
     for (const uniform_block_t& ub: src->refl.uniform_blocks) {
         if (ub.slot >= 0) {
-            L("    if (0 == strcmp(ub_name, \"{}\")) {{\n", ub.struct_name);
-            L("      return {};\n", ub.slot);
-            L("    }}\n");
+            cases.push_back({ ub.struct_name, [&ub](const std::string& ind) { L("{}return {};\n", ind, ub.slot); } });
         }
     }
+    write_name_switch("    ", "ub_name", cases);
 }
 
 static void write_uniformblock_slot_func(const program_t& prog, const args_t& args, const input_t& inp, const spirvcross_t& spirvcross) {
@@ -675,13 +1122,13 @@ static void write_uniformblock_slot_func(const program_t& prog, const args_t& ar
 }
 
 static void write_uniformblock_size_stage(const spirvcross_source_t* src, const input_t& inp) {
+    name_cases_t cases;
     for (const uniform_block_t& ub: src->refl.uniform_blocks) {
         if (ub.slot >= 0) {
-            L("    if (0 == strcmp(ub_name, \"{}\")) {{\n", ub.struct_name);
-            L("      return sizeof({}{}_t);\n", mod_prefix(inp), ub.struct_name);
-            L("    }}\n");
+            cases.push_back({ ub.struct_name, [&ub, &inp](const std::string& ind) { L("{}return sizeof({}{}_t);\n", ind, mod_prefix(inp), ub.struct_name); } });
         }
     }
+    write_name_switch("    ", "ub_name", cases);
 }
 
 static void write_uniformblock_size_func(const program_t& prog, const args_t& args, const input_t& inp, const spirvcross_t& spirvcross) {
@@ -705,18 +1152,52 @@ static void write_uniformblock_size_func(const program_t& prog, const args_t& ar
     L("}}\n");
 }
 
+static void write_uniformblock_active_size_stage(const spirvcross_source_t* src) {
+    name_cases_t cases;
+    for (const uniform_block_t& ub: src->refl.uniform_blocks) {
+        if (ub.slot >= 0) {
+            cases.push_back({ ub.struct_name, [&ub](const std::string& ind) { L("{}return {};\n", ind, ub.active_prefix_size); } });
+        }
+    }
+    write_name_switch("    ", "ub_name", cases);
+}
+
+static void write_uniformblock_active_size_func(const program_t& prog, const args_t& args, const input_t& inp, const spirvcross_t& spirvcross) {
+    const spirvcross_source_t* vs_src = find_spirvcross_source_by_shader_name(prog.vs_name, inp, spirvcross);
+    const spirvcross_source_t* fs_src = find_spirvcross_source_by_shader_name(prog.fs_name, inp, spirvcross);
+    assert(vs_src && fs_src);
+
+    L("{}size_t {}{}_uniformblock_active_size(sg_shader_stage stage, const char* ub_name) {{\n", func_prefix(args), mod_prefix(inp), prog.name);
+    L("  (void)stage; (void)ub_name;\n");
+    if (!vs_src->refl.uniform_blocks.empty()) {
+        L("  if (SG_SHADERSTAGE_VS == stage) {{\n");
+        write_uniformblock_active_size_stage(vs_src);
+        L("  }}\n");
+    }
+    if (!fs_src->refl.uniform_blocks.empty()) {
+        L("  if (SG_SHADERSTAGE_FS == stage) {{\n");
+        write_uniformblock_active_size_stage(fs_src);
+        L("  }}\n");
+    }
+    L("  return 0;\n");
+    L("}}\n");
+}
+
 static void write_uniform_offset_stage(const spirvcross_source_t* src) {
+    name_cases_t cases;
     for (const uniform_block_t& ub: src->refl.uniform_blocks) {
         if (ub.slot >= 0) {
-            L("    if (0 == strcmp(ub_name, \"{}\")) {{\n", ub.struct_name);
-            for (const uniform_t& u: ub.uniforms) {
-                L("      if (0 == strcmp(u_name, \"{}\")) {{\n", u.name);
-                L("        return {};\n", u.offset);
-                L("      }}\n");
-            }
-            L("    }}\n");
+            cases.push_back({ ub.struct_name, [&ub](const std::string& ind) {
+                name_cases_t u_cases;
+                for (const uniform_t& u: ub.uniforms) {
+                    u_cases.push_back({ u.name, [&u](const std::string& u_ind) { L("{}return {};\n", u_ind, u.offset); } });
+                }
+                write_name_switch(ind, "u_name", u_cases);
+                L("{}return -1;\n", ind);
+            }});
         }
     }
+    write_name_switch("    ", "ub_name", cases);
 }
 
 static void write_uniform_offset_func(const program_t& prog, const args_t& args, const input_t& inp, const spirvcross_t& spirvcross) {
@@ -741,20 +1222,25 @@ static void write_uniform_offset_func(const program_t& prog, const args_t& args,
 }
 
 static void write_uniform_desc_stage(const spirvcross_source_t* src) {
+    name_cases_t cases;
     for (const uniform_block_t& ub: src->refl.uniform_blocks) {
         if (ub.slot >= 0) {
-            L("    if (0 == strcmp(ub_name, \"{}\")) {{\n", ub.struct_name);
-            for (const uniform_t& u: ub.uniforms) {
-                L("      if (0 == strcmp(u_name, \"{}\")) {{\n", u.name);
-                L("        desc.name = \"{}\";\n", u.name);
-                L("        desc.type = {};\n", uniform_type_to_sokol_type_str(u.type));
-                L("        desc.array_count = {};\n", u.array_count);
-                L("        return desc;\n");
-                L("      }}\n");
-            }
-            L("    }}\n");
+            cases.push_back({ ub.struct_name, [&ub](const std::string& ind) {
+                name_cases_t u_cases;
+                for (const uniform_t& u: ub.uniforms) {
+                    u_cases.push_back({ u.name, [&u](const std::string& u_ind) {
+                        L("{}desc.name = \"{}\";\n", u_ind, u.name);
+                        L("{}desc.type = {};\n", u_ind, uniform_type_to_sokol_type_str(u.type));
+                        L("{}desc.array_count = {};\n", u_ind, u.array_count);
+                        L("{}return desc;\n", u_ind);
+                    }});
+                }
+                write_name_switch(ind, "u_name", u_cases);
+                L("{}return desc;\n", ind);
+            }});
         }
     }
+    write_name_switch("    ", "ub_name", cases);
 }
 
 static void write_uniform_desc_func(const program_t& prog, const args_t& args, const input_t& inp, const spirvcross_t& spirvcross) {
@@ -784,13 +1270,117 @@ static void write_uniform_desc_func(const program_t& prog, const args_t& args, c
 
 }
 
+/* The by-id reflection functions are table lookups indexed by shader stage and
+   the per-program integer ids, a value of -1 (or size 0) means that the
+   resource isn't used on that shader stage.
+*/
+static void write_slot_table(const char* indent, const std::vector<std::vector<int>>& stage_values) {
+    L("{}static const int table[2][{}] = {{\n", indent, stage_values[0].size());
+    for (const std::vector<int>& values: stage_values) {
+        L("{}  {{ ", indent);
+        for (int val: values) {
+            L("{}, ", val);
+        }
+        L("}},\n");
+    }
+    L("{}}};\n", indent);
+}
+
+static void write_by_id_funcs(const program_t& prog, const args_t& args, const input_t& inp, const spirvcross_t& spirvcross) {
+    const prog_resources_t res = gather_prog_resources(prog, inp, spirvcross);
+    const std::string prefix = fmt::format("{}{}", mod_prefix(inp), prog.name);
+    if (!res.attrs.empty()) {
+        L("{}int {}_attr_slot_by_id({}_attr_id_t id) {{\n", func_prefix(args), prefix, prefix);
+        L("  static const int table[{}] = {{ ", res.attrs.size());
+        for (const attr_t* attr: res.attrs) {
+            L("{}, ", attr->slot);
+        }
+        L("}};\n");
+        L("  return table[id];\n");
+        L("}}\n");
+    }
+    if (!res.images.empty()) {
+        std::vector<std::vector<int>> slots(2);
+        for (int stage = 0; stage < 2; stage++) {
+            for (const image_t* img: res.images) {
+                const image_t* stage_img = find_image_by_name(res.src[stage]->refl, img->name);
+                slots[stage].push_back(stage_img ? stage_img->slot : -1);
+            }
+        }
+        L("{}int {}_image_slot_by_id(sg_shader_stage stage, {}_image_id_t id) {{\n", func_prefix(args), prefix, prefix);
+        write_slot_table("  ", slots);
+        L("  return table[stage][id];\n");
+        L("}}\n");
+    }
+    if (!res.samplers.empty()) {
+        std::vector<std::vector<int>> slots(2);
+        for (int stage = 0; stage < 2; stage++) {
+            for (const sampler_t* smp: res.samplers) {
+                const sampler_t* stage_smp = find_sampler_by_name(res.src[stage]->refl, smp->name);
+                slots[stage].push_back(stage_smp ? stage_smp->slot : -1);
+            }
+        }
+        L("{}int {}_sampler_slot_by_id(sg_shader_stage stage, {}_sampler_id_t id) {{\n", func_prefix(args), prefix, prefix);
+        write_slot_table("  ", slots);
+        L("  return table[stage][id];\n");
+        L("}}\n");
+    }
+    if (!res.uniform_blocks.empty()) {
+        std::vector<std::vector<int>> slots(2);
+        std::vector<std::vector<bool>> used(2);
+        for (int stage = 0; stage < 2; stage++) {
+            for (const uniform_block_t* ub: res.uniform_blocks) {
+                const uniform_block_t* stage_ub = find_uniform_block_by_name(res.src[stage]->refl, ub->struct_name);
+                slots[stage].push_back(stage_ub ? stage_ub->slot : -1);
+                used[stage].push_back(stage_ub != nullptr);
+            }
+        }
+        L("{}int {}_uniformblock_slot_by_id(sg_shader_stage stage, {}_uniformblock_id_t id) {{\n", func_prefix(args), prefix, prefix);
+        write_slot_table("  ", slots);
+        L("  return table[stage][id];\n");
+        L("}}\n");
+        L("{}size_t {}_uniformblock_size_by_id(sg_shader_stage stage, {}_uniformblock_id_t id) {{\n", func_prefix(args), prefix, prefix);
+        L("  static const size_t table[2][{}] = {{\n", res.uniform_blocks.size());
+        for (int stage = 0; stage < 2; stage++) {
+            L("    {{ ");
+            for (int i = 0; i < (int)res.uniform_blocks.size(); i++) {
+                if (used[stage][i]) {
+                    L("sizeof({}{}_t), ", mod_prefix(inp), res.uniform_blocks[i]->struct_name);
+                }
+                else {
+                    L("0, ");
+                }
+            }
+            L("}},\n");
+        }
+        L("  }};\n");
+        L("  return table[stage][id];\n");
+        L("}}\n");
+    }
+    if (!res.uniforms.empty()) {
+        std::vector<std::vector<int>> offsets(2);
+        for (int stage = 0; stage < 2; stage++) {
+            for (const auto& u: res.uniforms) {
+                const bool used = nullptr != find_uniform_block_by_name(res.src[stage]->refl, u.first->struct_name);
+                offsets[stage].push_back(used ? u.second->offset : -1);
+            }
+        }
+        L("{}int {}_uniform_offset_by_id(sg_shader_stage stage, {}_uniform_id_t id) {{\n", func_prefix(args), prefix, prefix);
+        write_slot_table("  ", offsets);
+        L("  return table[stage][id];\n");
+        L("}}\n");
+    }
+}
+
 errmsg_t sokol_t::gen(const args_t& args, const input_t& inp,
                      const std::array<spirvcross_t,slang_t::NUM>& spirvcross,
-                     const std::array<bytecode_t,slang_t::NUM>& bytecode)
+                     const std::array<bytecode_t,slang_t::NUM>& bytecode,
+                     output_t& out)
 {
     // first write everything into a string, and only when no errors occur,
     // dump this into a file (so we don't have half-written files lying around)
     file_content.clear();
+    sidecar_files.clear();
 
     L("#pragma once\n");
     errmsg_t err;
@@ -810,7 +1400,10 @@ errmsg_t sokol_t::gen(const args_t& args, const input_t& inp,
             }
             if (!common_decls_written) {
                 common_decls_written = true;
-                write_common_decls(slang, args, inp, spirvcross[i]);
+                err = write_common_decls(slang, args, inp, spirvcross[i]);
+                if (err.valid) {
+                    return err;
+                }
             }
             if (!guard_written) {
                 guard_written = true;
@@ -824,7 +1417,7 @@ errmsg_t sokol_t::gen(const args_t& args, const input_t& inp,
             if (args.ifdef) {
                 L("#if defined({})\n", sokol_define(slang));
             }
-            write_shader_sources_and_blobs(inp, spirvcross[i], bytecode[i], slang);
+            write_shader_sources_and_blobs(args, inp, spirvcross[i], bytecode[i], slang);
             if (args.ifdef) {
                 L("#endif /* {} */\n", sokol_define(slang));
             }
@@ -840,6 +1433,7 @@ errmsg_t sokol_t::gen(const args_t& args, const input_t& inp,
     for (const auto& item: inp.programs) {
         const program_t& prog = item.second;
         write_shader_desc_func(prog, args, inp, spirvcross, bytecode);
+        write_shader_hash_func(prog, args, inp, spirvcross, bytecode);
         if (args.reflection) {
             int slang_index = (int)slang_t::first_valid(args.slang);
             assert((slang_index >= 0) && (slang_index < slang_t::NUM));
@@ -848,8 +1442,10 @@ errmsg_t sokol_t::gen(const args_t& args, const input_t& inp,
             write_sampler_slot_func(prog, args, inp, spirvcross[slang_index]);
             write_uniformblock_slot_func(prog, args, inp, spirvcross[slang_index]);
             write_uniformblock_size_func(prog, args, inp, spirvcross[slang_index]);
+            write_uniformblock_active_size_func(prog, args, inp, spirvcross[slang_index]);
             write_uniform_offset_func(prog, args, inp, spirvcross[slang_index]);
             write_uniform_desc_func(prog, args, inp, spirvcross[slang_index]);
+            write_by_id_funcs(prog, args, inp, spirvcross[slang_index]);
         }
     }
 
@@ -862,13 +1458,11 @@ errmsg_t sokol_t::gen(const args_t& args, const input_t& inp,
         }
     }
 
-    // write result into output file
-    FILE* f = fopen(args.output.c_str(), "w");
-    if (!f) {
-        return errmsg_t::error(inp.base_path, 0, fmt::format("failed to open output file '{}'", args.output));
+    // add result and the sidecar files referenced by #embed to output files
+    out.add(args.output, file_content);
+    for (const auto& sidecar: sidecar_files) {
+        out.add(sidecar.first, std::string(sidecar.second.begin(), sidecar.second.end()));
     }
-    fwrite(file_content.c_str(), file_content.length(), 1, f);
-    fclose(f);
     return errmsg_t();
 }
 
@@ -142,6 +142,7 @@ static void write_header(const args_t& args, const input_t& inp, const spirvcros
             L("                    Sampler: {}\n", img_smp.sampler_name);
         }
         L("            Fragment shader: {}\n", prog.fs_name);
+        L("                Early-Z: discard={}, depth write={}, side effects={}, sample rate={}\n", fs_src->refl.uses_discard, fs_src->refl.writes_depth, fs_src->refl.has_side_effects, fs_src->refl.sample_rate);
         for (const uniform_block_t& ub: fs_src->refl.uniform_blocks) {
             L("                Uniform block '{}':\n", ub.struct_name);
             L("                    C struct: {}{}_t\n", mod_prefix(inp), ub.struct_name);
@@ -179,12 +180,28 @@ static void write_vertex_attrs(const input_t& inp, const spirvcross_t& spirvcros
             for (const attr_t& attr: src.refl.inputs) {
                 if (attr.slot >= 0) {
                     L("ATTR_{}{}_{} :: {}\n", mod_prefix(inp), vs_snippet.name, attr.name, attr.slot);
+                    if (attr.num_components > 0) {
+                        L("ATTR_USED_{}{}_{} :: {:#x}\n", mod_prefix(inp), vs_snippet.name, attr.name, attr.used_components);
+                    }
                 }
             }
         }
     }
 }
 
+// fragment shader properties which affect early depth testing
+static void write_fs_flags(const input_t& inp, const spirvcross_t& spirvcross) {
+    for (const spirvcross_source_t& src: spirvcross.sources) {
+        if (src.refl.stage == stage_t::FS) {
+            const snippet_t& fs_snippet = inp.snippets[src.snippet_index];
+            L("USES_DISCARD_{}{} :: {}\n", mod_prefix(inp), fs_snippet.name, src.refl.uses_discard);
+            L("WRITES_DEPTH_{}{} :: {}\n", mod_prefix(inp), fs_snippet.name, src.refl.writes_depth);
+            L("HAS_SIDE_EFFECTS_{}{} :: {}\n", mod_prefix(inp), fs_snippet.name, src.refl.has_side_effects);
+            L("SAMPLE_RATE_{}{} :: {}\n", mod_prefix(inp), fs_snippet.name, src.refl.sample_rate);
+        }
+    }
+}
+
 static void write_image_bind_slots(const input_t& inp, const spirvcross_t& spirvcross) {
     for (const image_t& img: spirvcross.unique_images) {
         L("SLOT_{}{} :: {}\n", mod_prefix(inp), img.name, img.slot);
@@ -200,6 +217,7 @@ static void write_sampler_bind_slots(const input_t& inp, const spirvcross_t& spi
 static void write_uniform_blocks(const input_t& inp, const spirvcross_t& spirvcross, slang_t::type_t slang) {
     for (const uniform_block_t& ub: spirvcross.unique_uniform_blocks) {
         L("SLOT_{}{} :: {}\n", mod_prefix(inp), ub.struct_name, ub.slot);
+        L("ACTIVE_SIZE_{}{} :: {}\n", mod_prefix(inp), ub.struct_name, ub.active_prefix_size);
         L("{} :: struct {{\n", to_ada_case(fmt::format("{}{}", mod_prefix(inp), ub.struct_name)));
         int cur_offset = 0;
         for (const uniform_t& uniform: ub.uniforms) {
@@ -260,7 +278,7 @@ static void write_shader_sources_and_blobs(const input_t& inp,
 {
     for (int snippet_index = 0; snippet_index < (int)inp.snippets.size(); snippet_index++) {
         const snippet_t& snippet = inp.snippets[snippet_index];
-        if ((snippet.type != snippet_t::VS) && (snippet.type != snippet_t::FS)) {
+        if (((snippet.type != snippet_t::VS) && (snippet.type != snippet_t::FS)) || snippet.specialized_only) {
             continue;
         }
         int src_index = spirvcross.find_source_by_snippet_index(snippet_index);
@@ -435,7 +453,8 @@ static void write_shader_desc_init(const char* indent, const program_t& prog, co
 
 errmsg_t sokolodin_t::gen(const args_t& args, const input_t& inp,
                      const std::array<spirvcross_t,slang_t::NUM>& spirvcross,
-                     const std::array<bytecode_t,slang_t::NUM>& bytecode)
+                     const std::array<bytecode_t,slang_t::NUM>& bytecode,
+                     output_t& out)
 {
     // first write everything into a string, and only when no errors occur,
     // dump this into a file (so we don't have half-written files lying around)
@@ -457,6 +476,7 @@ errmsg_t sokolodin_t::gen(const args_t& args, const input_t& inp,
             if (!common_decls_written) {
                 common_decls_written = true;
                 write_vertex_attrs(inp, spirvcross[i]);
+                write_fs_flags(inp, spirvcross[i]);
                 write_image_bind_slots(inp, spirvcross[i]);
                 write_sampler_bind_slots(inp, spirvcross[i]);
                 write_uniform_blocks(inp, spirvcross[i], slang);
@@ -484,13 +504,8 @@ errmsg_t sokolodin_t::gen(const args_t& args, const input_t& inp,
         L("}}\n");
     }
 
-    // write result into output file
-    FILE* f = fopen(args.output.c_str(), "w");
-    if (!f) {
-        return errmsg_t::error(inp.base_path, 0, fmt::format("failed to open output file '{}'", args.output));
-    }
-    fwrite(file_content.c_str(), file_content.length(), 1, f);
-    fclose(f);
+    // add result to output files
+    out.add(args.output, file_content);
     return errmsg_t();
 }
 
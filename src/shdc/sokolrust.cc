@@ -142,6 +142,7 @@ static void write_header(const args_t& args, const input_t& inp, const spirvcros
             L("                    Sampler: {}\n", img_smp.sampler_name);
         }
         L("            Fragment shader: {}\n", prog.fs_name);
+        L("                Early-Z: discard={}, depth write={}, side effects={}, sample rate={}\n", fs_src->refl.uses_discard, fs_src->refl.writes_depth, fs_src->refl.has_side_effects, fs_src->refl.sample_rate);
         for (const uniform_block_t& ub: fs_src->refl.uniform_blocks) {
             L("                Uniform block '{}':\n", ub.struct_name);
             L("                    C struct: {}{}_t\n", mod_prefix(inp), ub.struct_name);
@@ -185,12 +186,28 @@ static void write_vertex_attrs(const input_t& inp, const spirvcross_t& spirvcros
             for (const attr_t& attr: src.refl.inputs) {
                 if (attr.slot >= 0) {
                     L("pub const ATTR_{}{}_{}: usize = {};\n", to_upper_case(mod_prefix(inp)), to_upper_case(vs_snippet.name), to_upper_case(attr.name), attr.slot);
+                    if (attr.num_components > 0) {
+                        L("pub const ATTR_USED_{}{}_{}: u32 = {:#x};\n", to_upper_case(mod_prefix(inp)), to_upper_case(vs_snippet.name), to_upper_case(attr.name), attr.used_components);
+                    }
                 }
             }
         }
     }
 }
 
+// fragment shader properties which affect early depth testing
+static void write_fs_flags(const input_t& inp, const spirvcross_t& spirvcross) {
+    for (const spirvcross_source_t& src: spirvcross.sources) {
+        if (src.refl.stage == stage_t::FS) {
+            const snippet_t& fs_snippet = inp.snippets[src.snippet_index];
+            L("pub const USES_DISCARD_{}{}: bool = {};\n", to_upper_case(mod_prefix(inp)), to_upper_case(fs_snippet.name), src.refl.uses_discard);
+            L("pub const WRITES_DEPTH_{}{}: bool = {};\n", to_upper_case(mod_prefix(inp)), to_upper_case(fs_snippet.name), src.refl.writes_depth);
+            L("pub const HAS_SIDE_EFFECTS_{}{}: bool = {};\n", to_upper_case(mod_prefix(inp)), to_upper_case(fs_snippet.name), src.refl.has_side_effects);
+            L("pub const SAMPLE_RATE_{}{}: bool = {};\n", to_upper_case(mod_prefix(inp)), to_upper_case(fs_snippet.name), src.refl.sample_rate);
+        }
+    }
+}
+
 static void write_image_bind_slots(const input_t& inp, const spirvcross_t& spirvcross) {
     for (const image_t& img: spirvcross.unique_images) {
         L("pub const SLOT_{}{}: usize = {};\n", to_upper_case(mod_prefix(inp)), to_upper_case(img.name), img.slot);
@@ -206,6 +223,7 @@ static void write_sampler_bind_slots(const input_t& inp, const spirvcross_t& spi
 static void write_uniform_blocks(const input_t& inp, const spirvcross_t& spirvcross, slang_t::type_t slang) {
     for (const uniform_block_t& ub: spirvcross.unique_uniform_blocks) {
         L("pub const SLOT_{}{}: usize = {};\n", to_upper_case(mod_prefix(inp)), to_upper_case(ub.struct_name), ub.slot);
+        L("pub const ACTIVE_SIZE_{}{}: usize = {};\n", to_upper_case(mod_prefix(inp)), to_upper_case(ub.struct_name), ub.active_prefix_size);
 
         /*
            TODO: Should this be "#[repr(C), align(16)]"? I saw that sokolzig.cc mentioned being 16-aligned
@@ -280,7 +298,7 @@ static void write_shader_sources_and_blobs(const input_t& inp,
 {
     for (int snippet_index = 0; snippet_index < (int)inp.snippets.size(); snippet_index++) {
         const snippet_t& snippet = inp.snippets[snippet_index];
-        if ((snippet.type != snippet_t::VS) && (snippet.type != snippet_t::FS)) {
+        if (((snippet.type != snippet_t::VS) && (snippet.type != snippet_t::FS)) || snippet.specialized_only) {
             continue;
         }
         int src_index = spirvcross.find_source_by_snippet_index(snippet_index);
@@ -454,7 +472,8 @@ static void write_shader_desc_init(const char* indent, const program_t& prog, co
 
 errmsg_t sokolrust_t::gen(const args_t& args, const input_t& inp,
                      const std::array<spirvcross_t,slang_t::NUM>& spirvcross,
-                     const std::array<bytecode_t,slang_t::NUM>& bytecode)
+                     const std::array<bytecode_t,slang_t::NUM>& bytecode,
+                     output_t& out)
 {
     // first write everything into a string, and only when no errors occur,
     // dump this into a file (so we don't have half-written files lying around)
@@ -478,6 +497,7 @@ errmsg_t sokolrust_t::gen(const args_t& args, const input_t& inp,
             if (!common_decls_written) {
                 common_decls_written = true;
                 write_vertex_attrs(inp, spirvcross[i]);
+                write_fs_flags(inp, spirvcross[i]);
                 write_image_bind_slots(inp, spirvcross[i]);
                 write_sampler_bind_slots(inp, spirvcross[i]);
                 write_uniform_blocks(inp, spirvcross[i], slang);
@@ -506,15 +526,21 @@ errmsg_t sokolrust_t::gen(const args_t& args, const input_t& inp,
         L("    }}\n");
         L("    desc\n");
         L("}}\n");
+        L("pub fn {}{}_shader_hash(backend: sg::Backend) -> u64 {{\n", mod_prefix(inp), prog.name);
+        L("    match backend {{\n");
+        for (int i = 0; i < slang_t::NUM; i++) {
+            slang_t::type_t slang = (slang_t::type_t) i;
+            if (args.slang & slang_t::bit(slang)) {
+                L("        {} => 0x{:016X},\n", sokol_backend(slang), program_hash(prog, inp, spirvcross[i], bytecode[i], slang));
+            }
+        }
+        L("        _ => 0,\n");
+        L("    }}\n");
+        L("}}\n");
     }
 
-    // write result into output file
-    FILE* f = fopen(args.output.c_str(), "w");
-    if (!f) {
-        return errmsg_t::error(inp.base_path, 0, fmt::format("failed to open output file '{}'", args.output));
-    }
-    fwrite(file_content.c_str(), file_content.length(), 1, f);
-    fclose(f);
+    // add result to output files
+    out.add(args.output, file_content);
     return errmsg_t();
 }
 
@@ -2,6 +2,8 @@
     compile GLSL to SPIRV, wrapper around https://github.com/KhronosGroup/glslang
 */
 #include <stdlib.h>
+#include <set>
+#include <unordered_set>
 #include "shdc.h"
 #include "fmt/format.h"
 #include "pystring.h"
@@ -13,12 +15,23 @@
 
 namespace shdc {
 
+// glslang is initialized lazily on the first compile_glsl() call, so that
+// runs which don't compile anything (e.g. --help) don't pay for it
+static bool glslang_initialized = false;
+
 void spirv_t::initialize_spirv_tools() {
-    glslang::InitializeProcess();
+    if (!glslang_initialized) {
+        trace_span_t span("init_glslang");
+        glslang::InitializeProcess();
+        glslang_initialized = true;
+    }
 }
 
 void spirv_t::finalize_spirv_tools() {
-    glslang::FinalizeProcess();
+    if (glslang_initialized) {
+        glslang::FinalizeProcess();
+        glslang_initialized = false;
+    }
 }
 
 // defined at end of file
@@ -31,8 +44,12 @@ static std::string merge_source(const input_t& inp, const snippet_t& snippet, sl
     src += fmt::format("#define SOKOL_HLSL ({})\n", slang_t::is_hlsl(slang) ? 1 : 0);
     src += fmt::format("#define SOKOL_MSL ({})\n", slang_t::is_msl(slang) ? 1 : 0);
     src += fmt::format("#define SOKOL_WGSL ({})\n", slang_t::is_wgsl(slang) ? 1 : 0);
+    src += fmt::format("#define SOKOL_SPIRV ({})\n", slang_t::is_spirv(slang) ? 1 : 0);
     for (const std::string& define : defines) {
-        src += fmt::format("#define {} (1)\n", define);
+        src += util::define_to_glsl(define);
+    }
+    for (const std::string& define : snippet.defines) {
+        src += util::define_to_glsl(define);
     }
     for (int line_index : snippet.lines) {
         src += fmt::format("{}\n", inp.lines[line_index].line);
@@ -40,8 +57,28 @@ static std::string merge_source(const input_t& inp, const snippet_t& snippet, sl
     return src;
 }
 
+/* number of lines merge_source() puts in front of the snippet source */
+static int num_prolog_lines(const args_t& args, const snippet_t& snippet) {
+    return 6 + (int)args.defines.size() + (int)snippet.defines.size();
+}
+
+/* check if any define has a value (NAME=VALUE) */
+static bool has_valued_defines(const args_t& args, const snippet_t& snippet) {
+    for (const std::string& define: args.defines) {
+        if (define.find('=') != std::string::npos) {
+            return true;
+        }
+    }
+    for (const std::string& define: snippet.defines) {
+        if (define.find('=') != std::string::npos) {
+            return true;
+        }
+    }
+    return false;
+}
+
 /* convert a glslang info-log string to errmsg_t's and append to out_errors */
-static void infolog_to_errors(const std::string& log, const input_t& inp, int snippet_index, std::vector<errmsg_t>& out_errors) {
+static void infolog_to_errors(const std::string& log, const input_t& inp, int snippet_index, int prolog_lines, std::vector<errmsg_t>& out_errors) {
     /*
         format for errors is "[ERROR|WARNING]: [pos=0?]:[line]: message"
         And a last line we need to ignore: "ERROR: N compilation errors. ..."
@@ -68,7 +105,7 @@ static void infolog_to_errors(const std::string& log, const input_t& inp, int sn
                 int snippet_line_index = atoi(tokens[2].c_str());
                 // correct for one-based and prolog #defines
                 if (snippet_line_index >= 1) {
-                    snippet_line_index -= 5;
+                    snippet_line_index -= prolog_lines;
                 }
                 // everything after the 3rd colon is 'msg'
                 for (int i = 3; i < (int)tokens.size(); i++) {
@@ -108,7 +145,7 @@ static void infolog_to_errors(const std::string& log, const input_t& inp, int sn
     bounded for-loops are converted to what looks like an unbounded loop
     ("for (;;) { }") to WebGL
 */
-static void spirv_optimize(slang_t::type_t slang, std::vector<uint32_t>& spirv) {
+static void spirv_optimize(slang_t::type_t slang, bool relax_precision, bool specialize, std::vector<uint32_t>& spirv) {
     if (slang == slang_t::WGSL) {
         return;
     }
@@ -130,6 +167,15 @@ static void spirv_optimize(slang_t::type_t slang, std::vector<uint32_t>& spirv)
     optimizer.RegisterPass(spvtools::CreateLocalAccessChainConvertPass());
     optimizer.RegisterPass(spvtools::CreateLocalSingleBlockLoadStoreElimPass());
     optimizer.RegisterPass(spvtools::CreateLocalSingleStoreElimPass());
+    // NOTE: with valued defines, loop bounds are usually compile-time constants,
+    // convert to SSA form so that constants are propagated and such loops are
+    // fully unrolled (skipped for WebGL, see the NOTE on LocalMultiStoreElimPass below)
+    if (specialize && (slang != slang_t::GLSL100)) {
+        optimizer.RegisterPass(spvtools::CreateSSARewritePass());
+        optimizer.RegisterPass(spvtools::CreateCCPPass());
+        optimizer.RegisterPass(spvtools::CreateLoopUnrollPass(true));
+        optimizer.RegisterPass(spvtools::CreateCCPPass());
+    }
     optimizer.RegisterPass(spvtools::CreateSimplificationPass());
     optimizer.RegisterPass(spvtools::CreateAggressiveDCEPass(true));    // NOTE: call the "preserveInterface" version of CreateAggressiveDCEPass()
     optimizer.RegisterPass(spvtools::CreateVectorDCEPass());
@@ -149,17 +195,456 @@ static void spirv_optimize(slang_t::type_t slang, std::vector<uint32_t>& spirv)
     optimizer.RegisterPass(spvtools::CreateRedundancyEliminationPass());
     optimizer.RegisterPass(spvtools::CreateAggressiveDCEPass(true));
     optimizer.RegisterPass(spvtools::CreateCFGCleanupPass());
+    if (relax_precision) {
+        // decorate float ops as RelaxedPrecision, SPIRV-Cross turns this into
+        // mediump in GLSL, for Metal convert the relaxed ops to actual 16-bit floats
+        optimizer.RegisterPass(spvtools::CreateRelaxFloatOpsPass());
+        if ((slang == slang_t::METAL_IOS) || (slang == slang_t::METAL_SIM)) {
+            // the conversion inserts float32<=>float16 conversions at the boundaries
+            // of relaxed code, clean up the redundant ones and dead code afterwards
+            optimizer.RegisterPass(spvtools::CreateConvertRelaxedToHalfPass());
+            optimizer.RegisterPass(spvtools::CreateSimplificationPass());
+            optimizer.RegisterPass(spvtools::CreateRedundancyEliminationPass());
+            optimizer.RegisterPass(spvtools::CreateAggressiveDCEPass(true));
+            optimizer.RegisterPass(spvtools::CreateCFGCleanupPass());
+        }
+    }
 
     spvtools::OptimizerOptions spvOptOptions;
     spvOptOptions.set_run_validator(false); // The validator may run as a separate step later on
     optimizer.Run(spirv.data(), spirv.size(), &spirv, spvOptOptions);
 }
 
+// size and alignment of a uniform block member type in std140 layout, false if unsupported
+static bool spirv_std140_member(const std::map<uint32_t, const uint32_t*>& types,
+                                const std::map<uint32_t, uint32_t>& constants,
+                                uint32_t type_id,
+                                util::std140_member_t& out_member)
+{
+    auto it = types.find(type_id);
+    if (it == types.end()) {
+        return false;
+    }
+    const uint32_t* inst = it->second;
+    switch (inst[0] & spv::OpCodeMask) {
+        case spv::OpTypeFloat:
+        case spv::OpTypeInt:
+            if (inst[2] != 32) {
+                return false;
+            }
+            out_member.size = 4;
+            out_member.align = 4;
+            return true;
+        case spv::OpTypeVector:
+            {
+                util::std140_member_t comp;
+                if (!spirv_std140_member(types, constants, inst[2], comp) || (comp.size != 4)) {
+                    return false;
+                }
+                out_member.size = 4 * (int)inst[3];
+                out_member.align = (inst[3] == 2) ? 8 : 16;
+            }
+            return true;
+        case spv::OpTypeMatrix:
+            {
+                util::std140_member_t column;
+                if (!spirv_std140_member(types, constants, inst[2], column)) {
+                    return false;
+                }
+                out_member.size = util::roundup(column.size, 16) * (int)inst[3];
+                out_member.align = 16;
+            }
+            return true;
+        case spv::OpTypeArray:
+            {
+                util::std140_member_t elem;
+                auto len_it = constants.find(inst[3]);
+                if ((len_it == constants.end()) || !spirv_std140_member(types, constants, inst[2], elem)) {
+                    return false;
+                }
+                out_member.size = util::roundup(elem.size, 16) * (int)len_it->second;
+                out_member.align = 16;
+            }
+            return true;
+        default:
+            // nested structs and everything else isn't supported
+            return false;
+    }
+}
+
+/* Reorder the members of uniform blocks into a minimal-padding std140 layout
+   (--pack-uniforms). This permutes the OpTypeStruct member list and patches
+   the member names, member decorations and the struct indices of access
+   chains. Since the new order only depends on the member types and their
+   original order, all shader stages and target languages end up with the
+   same layout. Blocks which are accessed in any other way than through
+   access chains on the block variable are left alone.
+*/
+static void spirv_pack_uniform_blocks(std::vector<uint32_t>& spirv) {
+    if (spirv.size() < 5) {
+        return;
+    }
+    std::map<uint32_t, const uint32_t*> types;      // type id => type declaration
+    std::map<uint32_t, size_t> struct_pos;          // struct id => word pos of OpTypeStruct
+    std::map<uint32_t, uint32_t> constants;         // constant id => 32-bit value
+    std::map<uint32_t, uint32_t> constant_types;    // constant id => type id
+    std::map<uint32_t, uint32_t> pointee_types;     // pointer type id => pointee type id
+    std::map<uint32_t, uint32_t> ub_vars;           // uniform variable id => struct id
+    std::vector<uint32_t> block_structs;
+    std::vector<size_t> positions;
+    size_t first_func_pos = spirv.size();
+    for (size_t pos = 5; pos < spirv.size();) {
+        const uint32_t* inst = &spirv[pos];
+        const uint32_t op = inst[0] & spv::OpCodeMask;
+        const uint32_t word_count = inst[0] >> spv::WordCountShift;
+        if ((word_count == 0) || ((pos + word_count) > spirv.size())) {
+            return;
+        }
+        positions.push_back(pos);
+        switch (op) {
+            case spv::OpDecorate:
+                if (inst[2] == spv::DecorationBlock) {
+                    block_structs.push_back(inst[1]);
+                }
+                break;
+            case spv::OpTypeFloat:
+            case spv::OpTypeInt:
+            case spv::OpTypeVector:
+            case spv::OpTypeMatrix:
+            case spv::OpTypeArray:
+                types[inst[1]] = inst;
+                break;
+            case spv::OpTypeStruct:
+                types[inst[1]] = inst;
+                struct_pos[inst[1]] = pos;
+                break;
+            case spv::OpTypePointer:
+                pointee_types[inst[1]] = inst[3];
+                break;
+            case spv::OpConstant:
+                if (word_count == 4) {
+                    constants[inst[2]] = inst[3];
+                    constant_types[inst[2]] = inst[1];
+                }
+                break;
+            case spv::OpVariable:
+                if ((inst[3] == spv::StorageClassUniform) && (pointee_types.count(inst[1]) > 0)) {
+                    ub_vars[inst[2]] = pointee_types[inst[1]];
+                }
+                break;
+            case spv::OpFunction:
+                if (first_func_pos == spirv.size()) {
+                    first_func_pos = pos;
+                }
+                break;
+            default:
+                break;
+        }
+        pos += word_count;
+    }
+
+    uint32_t bound = spirv[3];
+    std::vector<uint32_t> new_constants;
+    for (uint32_t struct_id: block_structs) {
+        if (struct_pos.count(struct_id) == 0) {
+            continue;
+        }
+        const size_t spos = struct_pos[struct_id];
+        const int num_members = (int)(spirv[spos] >> spv::WordCountShift) - 2;
+        std::vector<util::std140_member_t> members(num_members);
+        bool supported = num_members > 1;
+        for (int i = 0; supported && (i < num_members); i++) {
+            supported = spirv_std140_member(types, constants, spirv[spos + 2 + i], members[i]);
+        }
+        // all access chains into the block must use constant member indices
+        for (size_t pos: positions) {
+            const uint32_t op = spirv[pos] & spv::OpCodeMask;
+            if (!supported) {
+                break;
+            }
+            if ((op == spv::OpAccessChain) || (op == spv::OpInBoundsAccessChain)) {
+                auto var_it = ub_vars.find(spirv[pos + 3]);
+                if ((var_it != ub_vars.end()) && (var_it->second == struct_id)) {
+                    supported = ((spirv[pos] >> spv::WordCountShift) > 4) && (constants.count(spirv[pos + 4]) > 0);
+                }
+            }
+            else if (op == spv::OpPtrAccessChain) {
+                auto var_it = ub_vars.find(spirv[pos + 3]);
+                supported = (var_it == ub_vars.end()) || (var_it->second != struct_id);
+            }
+        }
+        if (!supported) {
+            continue;
+        }
+        std::vector<int> identity(num_members);
+        for (int i = 0; i < num_members; i++) {
+            identity[i] = i;
+        }
+        std::vector<int> old_offsets, new_offsets;
+        const int old_size = util::std140_layout(members, identity, old_offsets);
+        const std::vector<int> order = util::std140_packed_order(members);
+        const int new_size = util::std140_layout(members, order, new_offsets);
+        if (new_size >= old_size) {
+            continue;
+        }
+        // old member index => new member index
+        std::vector<uint32_t> remap(num_members);
+        for (int i = 0; i < num_members; i++) {
+            remap[order[i]] = (uint32_t)i;
+        }
+        // permute the struct member types
+        const std::vector<uint32_t> member_types(spirv.begin() + spos + 2, spirv.begin() + spos + 2 + num_members);
+        for (int i = 0; i < num_members; i++) {
+            spirv[spos + 2 + i] = member_types[order[i]];
+        }
+        for (size_t pos: positions) {
+            const uint32_t op = spirv[pos] & spv::OpCodeMask;
+            if ((op == spv::OpMemberName) || (op == spv::OpMemberDecorate)) {
+                if ((spirv[pos + 1] == struct_id) && (spirv[pos + 2] < (uint32_t)num_members)) {
+                    const uint32_t old_index = spirv[pos + 2];
+                    spirv[pos + 2] = remap[old_index];
+                    if ((op == spv::OpMemberDecorate) && (spirv[pos + 3] == spv::DecorationOffset)) {
+                        spirv[pos + 4] = (uint32_t)new_offsets[old_index];
+                    }
+                }
+            }
+            else if ((op == spv::OpAccessChain) || (op == spv::OpInBoundsAccessChain)) {
+                auto var_it = ub_vars.find(spirv[pos + 3]);
+                if ((var_it == ub_vars.end()) || (var_it->second != struct_id)) {
+                    continue;
+                }
+                const uint32_t const_id = spirv[pos + 4];
+                const uint32_t const_type = constant_types[const_id];
+                const uint32_t new_index = remap[constants[const_id]];
+                // find or create an integer constant with the new member index
+                uint32_t new_const_id = 0;
+                for (const auto& item: constants) {
+                    if ((item.second == new_index) && (constant_types[item.first] == const_type)) {
+                        new_const_id = item.first;
+                        break;
+                    }
+                }
+                if (new_const_id == 0) {
+                    new_const_id = bound++;
+                    constants[new_const_id] = new_index;
+                    constant_types[new_const_id] = const_type;
+                    new_constants.push_back((4 << spv::WordCountShift) | spv::OpConstant);
+                    new_constants.push_back(const_type);
+                    new_constants.push_back(new_const_id);
+                    new_constants.push_back(new_index);
+                }
+                spirv[pos + 4] = new_const_id;
+            }
+        }
+    }
+    if (!new_constants.empty()) {
+        // new constants go at the end of the global declarations
+        spirv.insert(spirv.begin() + first_func_pos, new_constants.begin(), new_constants.end());
+        spirv[3] = bound;
+    }
+}
+
+/* Remove Input or Output variables from the module whose Location isn't in
+   live_locs (--link-opt). Only variables without any remaining references
+   (other than names, decorations and the entry point interface) are removed,
+   everything else is left alone.
+*/
+static void spirv_remove_dead_interface_vars(std::vector<uint32_t>& spirv, spv::StorageClass storage, const std::unordered_set<uint32_t>& live_locs) {
+    if (spirv.size() < 5) {
+        return;
+    }
+    std::map<uint32_t, uint32_t> locations;     // variable id => location
+    std::set<uint32_t> dead_vars;
+    for (size_t pos = 5; pos < spirv.size();) {
+        const uint32_t* inst = &spirv[pos];
+        const uint32_t op = inst[0] & spv::OpCodeMask;
+        const uint32_t word_count = inst[0] >> spv::WordCountShift;
+        if ((word_count == 0) || ((pos + word_count) > spirv.size())) {
+            return;
+        }
+        if ((op == spv::OpDecorate) && (word_count >= 4) && (inst[2] == spv::DecorationLocation)) {
+            locations[inst[1]] = inst[3];
+        }
+        else if ((op == spv::OpVariable) && (inst[3] == (uint32_t)storage)) {
+            auto it = locations.find(inst[2]);
+            if ((it != locations.end()) && (live_locs.count(it->second) == 0)) {
+                dead_vars.insert(inst[2]);
+            }
+        }
+        else if (op == spv::OpFunction) {
+            break;
+        }
+        pos += word_count;
+    }
+    // keep variables which are still referenced anywhere (conservatively
+    // treats any matching operand word as a reference)
+    for (size_t pos = 5; (pos < spirv.size()) && !dead_vars.empty();) {
+        const uint32_t* inst = &spirv[pos];
+        const uint32_t op = inst[0] & spv::OpCodeMask;
+        const uint32_t word_count = inst[0] >> spv::WordCountShift;
+        if ((op != spv::OpName) && (op != spv::OpDecorate) && (op != spv::OpEntryPoint) && (op != spv::OpVariable)) {
+            for (uint32_t i = 1; i < word_count; i++) {
+                dead_vars.erase(inst[i]);
+            }
+        }
+        pos += word_count;
+    }
+    if (dead_vars.empty()) {
+        return;
+    }
+    std::vector<uint32_t> res(spirv.begin(), spirv.begin() + 5);
+    for (size_t pos = 5; pos < spirv.size();) {
+        const uint32_t* inst = &spirv[pos];
+        const uint32_t op = inst[0] & spv::OpCodeMask;
+        const uint32_t word_count = inst[0] >> spv::WordCountShift;
+        if (((op == spv::OpName) || (op == spv::OpDecorate)) && (dead_vars.count(inst[1]) > 0)) {
+            // drop names and decorations of removed variables
+        }
+        else if ((op == spv::OpVariable) && (dead_vars.count(inst[2]) > 0)) {
+            // drop the variable itself
+        }
+        else if (op == spv::OpEntryPoint) {
+            // skip execution model, function id and the null-terminated name string
+            uint32_t i = 3;
+            while ((i < word_count) && ((inst[i] >> 24) != 0) && ((inst[i] & 0xFF) != 0) && ((inst[i] & 0xFF00) != 0) && ((inst[i] & 0xFF0000) != 0)) {
+                i++;
+            }
+            i++;
+            const size_t start = res.size();
+            res.insert(res.end(), inst, inst + std::min(i, word_count));
+            for (; i < word_count; i++) {
+                if (dead_vars.count(inst[i]) == 0) {
+                    res.push_back(inst[i]);
+                }
+            }
+            res[start] = ((uint32_t)(res.size() - start) << spv::WordCountShift) | op;
+        }
+        else {
+            res.insert(res.end(), inst, inst + word_count);
+        }
+        pos += word_count;
+    }
+    spirv = std::move(res);
+}
+
+/* gather the input locations and builtins which are actually read by a fragment shader */
+static void spirv_live_inputs(const std::vector<uint32_t>& spirv, std::unordered_set<uint32_t>& live_locs, std::unordered_set<uint32_t>& live_builtins) {
+    spvtools::Optimizer optimizer(SPV_ENV_UNIVERSAL_1_2);
+    optimizer.RegisterPass(spvtools::CreateAnalyzeLiveInputPass(&live_locs, &live_builtins));
+    spvtools::OptimizerOptions spvOptOptions;
+    spvOptOptions.set_run_validator(false);
+    std::vector<uint32_t> dummy;
+    optimizer.Run(spirv.data(), spirv.size(), &dummy, spvOptOptions);
+}
+
+/* remove vertex shader output stores which are not read by the fragment shader
+   and the computations feeding them
+*/
+static void spirv_eliminate_dead_outputs(std::vector<uint32_t>& spirv, std::unordered_set<uint32_t> live_locs, std::unordered_set<uint32_t> live_builtins) {
+    // builtin outputs which are consumed by the fixed-function pipeline
+    live_builtins.insert(spv::BuiltInPosition);
+    live_builtins.insert(spv::BuiltInPointSize);
+    live_builtins.insert(spv::BuiltInClipDistance);
+    live_builtins.insert(spv::BuiltInCullDistance);
+    spvtools::Optimizer optimizer(SPV_ENV_UNIVERSAL_1_2);
+    optimizer.RegisterPass(spvtools::CreateEliminateDeadOutputStoresPass(&live_locs, &live_builtins));
+    optimizer.RegisterPass(spvtools::CreateAggressiveDCEPass(true));
+    optimizer.RegisterPass(spvtools::CreateVectorDCEPass());
+    optimizer.RegisterPass(spvtools::CreateDeadInsertElimPass());
+    optimizer.RegisterPass(spvtools::CreateAggressiveDCEPass(true));
+    spvtools::OptimizerOptions spvOptOptions;
+    spvOptOptions.set_run_validator(false);
+    optimizer.Run(spirv.data(), spirv.size(), &spirv, spvOptOptions);
+    spirv_remove_dead_interface_vars(spirv, spv::StorageClassOutput, live_locs);
+}
+
+/* Link-time optimization of vertex shader outputs and fragment shader inputs
+   (--link-opt). Vertex- and fragment-shaders which are connected through
+   @program tags (directly or via shared shaders) are grouped, and all
+   varyings which aren't read by any fragment shader in the group are removed
+   from both sides, so that outputs and inputs still match for each program.
+*/
+static void spirv_link_optimize(const input_t& inp, slang_t::type_t slang, spirv_t& out_spirv) {
+    if (slang == slang_t::WGSL) {
+        return;
+    }
+    std::map<int, spirv_blob_t*> blobs;     // snippet index => SPIRV blob
+    for (spirv_blob_t& blob: out_spirv.blobs) {
+        blobs[blob.snippet_index] = &blob;
+    }
+    // group snippets connected through programs (union-find)
+    std::vector<int> group(inp.snippets.size());
+    for (int i = 0; i < (int)group.size(); i++) {
+        group[i] = i;
+    }
+    auto find_group = [&group](int i) {
+        while (group[i] != i) {
+            i = group[i] = group[group[i]];
+        }
+        return i;
+    };
+    std::vector<bool> linked(inp.snippets.size(), false);
+    for (const auto& item: inp.programs) {
+        const int vs_index = inp.vs_map.at(item.second.vs_name);
+        const int fs_index = inp.fs_map.at(item.second.fs_name);
+        linked[vs_index] = linked[fs_index] = true;
+        group[find_group(vs_index)] = find_group(fs_index);
+    }
+    // union of fragment shader inputs which are read in each group
+    std::map<int, std::unordered_set<uint32_t>> live_locs;
+    std::map<int, std::unordered_set<uint32_t>> live_builtins;
+    for (int i = 0; i < (int)inp.snippets.size(); i++) {
+        if (linked[i] && (inp.snippets[i].type == snippet_t::FS) && (blobs.count(i) > 0)) {
+            const int g = find_group(i);
+            spirv_live_inputs(blobs[i]->bytecode, live_locs[g], live_builtins[g]);
+        }
+    }
+    for (int i = 0; i < (int)inp.snippets.size(); i++) {
+        if (!linked[i] || (blobs.count(i) == 0)) {
+            continue;
+        }
+        const int g = find_group(i);
+        if (inp.snippets[i].type == snippet_t::VS) {
+            spirv_eliminate_dead_outputs(blobs[i]->bytecode, live_locs[g], live_builtins[g]);
+        }
+        else {
+            spirv_remove_dead_interface_vars(blobs[i]->bytecode, spv::StorageClassInput, live_locs[g]);
+        }
+    }
+}
+
+/* check if float precision should be relaxed for a snippet, only mobile
+    shader languages are affected, with --relax-precision all fragment shaders
+    are relaxed unless they opt out with 'full_precision', vertex shaders
+    must opt in with 'relax_precision'
+*/
+static bool relax_precision(const args_t& args, const snippet_t& snippet, slang_t::type_t slang) {
+    switch (slang) {
+        case slang_t::GLSL100:
+        case slang_t::GLSL300ES:
+        case slang_t::METAL_IOS:
+        case slang_t::METAL_SIM:
+            break;
+        default:
+            return false;
+    }
+    const uint32_t opts = snippet.options[(int)slang];
+    if (opts & option_t::FULL_PRECISION) {
+        return false;
+    }
+    if (opts & option_t::RELAX_PRECISION) {
+        return true;
+    }
+    return args.relax_precision && (snippet.type == snippet_t::FS);
+}
+
 /* compile a vertex or fragment shader to SPIRV */
-static bool compile(EShLanguage stage, slang_t::type_t slang, const std::string& src, const input_t& inp, int snippet_index, spirv_t& out_spirv) {
+static bool compile(const args_t& args, EShLanguage stage, slang_t::type_t slang, const std::string& src, const input_t& inp, int snippet_index, spirv_t& out_spirv) {
+    const trace_t::args_t trace_args = { { "snippet", inp.snippets[snippet_index].name }, { "slang", slang_t::to_str(slang) } };
     const char* sources[1] = { src.c_str() };
     const int sourcesLen[1] = { (int) src.length() };
     const char* sourcesNames[1] = { inp.base_path.c_str() };
+    const int prolog_lines = num_prolog_lines(args, inp.snippets[snippet_index]);
 
     // compile GLSL vertex- or fragment-shader
     glslang::TShader shader(stage);
@@ -173,9 +658,13 @@ static bool compile(EShLanguage stage, slang_t::type_t slang, const std::string&
     // We'll fix up the bindings later before calling SPIRVCross.
     shader.setAutoMapLocations(true);
     shader.setAutoMapBindings(true);
-    bool parse_success = shader.parse(GetDefaultResources(), 100, false, EShMsgDefault);
-    infolog_to_errors(shader.getInfoLog(), inp, snippet_index, out_spirv.errors);
-    infolog_to_errors(shader.getInfoDebugLog(), inp, snippet_index, out_spirv.errors);
+    bool parse_success;
+    {
+        trace_span_t span("glslang_parse", trace_args);
+        parse_success = shader.parse(GetDefaultResources(), 100, false, EShMsgDefault);
+    }
+    infolog_to_errors(shader.getInfoLog(), inp, snippet_index, prolog_lines, out_spirv.errors);
+    infolog_to_errors(shader.getInfoDebugLog(), inp, snippet_index, prolog_lines, out_spirv.errors);
     if (!parse_success) {
         return false;
     }
@@ -183,15 +672,23 @@ static bool compile(EShLanguage stage, slang_t::type_t slang, const std::string&
     // "link" into a program
     glslang::TProgram program;
     program.addShader(&shader);
-    bool link_success = program.link(EShMsgDefault);
-    infolog_to_errors(program.getInfoLog(), inp, snippet_index, out_spirv.errors);
-    infolog_to_errors(program.getInfoDebugLog(), inp, snippet_index, out_spirv.errors);
+    bool link_success;
+    {
+        trace_span_t span("glslang_link", trace_args);
+        link_success = program.link(EShMsgDefault);
+    }
+    infolog_to_errors(program.getInfoLog(), inp, snippet_index, prolog_lines, out_spirv.errors);
+    infolog_to_errors(program.getInfoDebugLog(), inp, snippet_index, prolog_lines, out_spirv.errors);
     if (!link_success) {
         return false;
     }
-    bool map_success = program.mapIO();
-    infolog_to_errors(program.getInfoLog(), inp, snippet_index, out_spirv.errors);
-    infolog_to_errors(program.getInfoDebugLog(), inp, snippet_index, out_spirv.errors);
+    bool map_success;
+    {
+        trace_span_t span("glslang_map_io", trace_args);
+        map_success = program.mapIO();
+    }
+    infolog_to_errors(program.getInfoLog(), inp, snippet_index, prolog_lines, out_spirv.errors);
+    infolog_to_errors(program.getInfoDebugLog(), inp, snippet_index, prolog_lines, out_spirv.errors);
     if (!map_success) {
         return false;
     }
@@ -211,43 +708,74 @@ static bool compile(EShLanguage stage, slang_t::type_t slang, const std::string&
     spv_options.emitNonSemanticShaderDebugInfo = false;
     spv_options.emitNonSemanticShaderDebugSource = false;
     out_spirv.blobs.push_back(spirv_blob_t(snippet_index));
-    out_spirv.blobs.back().source = src;
-    glslang::GlslangToSpv(*im, out_spirv.blobs.back().bytecode, &spv_logger, &spv_options);
+    // the merged source is only needed for debug inspection, don't keep it around otherwise
+    if (args.save_intermediate_spirv || args.debug_dump) {
+        out_spirv.blobs.back().source = src;
+    }
+    {
+        trace_span_t span("glslang_to_spv", trace_args);
+        glslang::GlslangToSpv(*im, out_spirv.blobs.back().bytecode, &spv_logger, &spv_options);
+    }
     std::string spirv_log = spv_logger.getAllMessages();
     if (!spirv_log.empty()) {
         // FIXME: need to parse string for errors and translate to errmsg_t objects?
         // haven't seen a case yet where this generates log messages
         fmt::print("{}", spirv_log);
     }
+    // optionally reorder uniform block members to minimize padding
+    if (args.pack_uniforms) {
+        spirv_pack_uniform_blocks(out_spirv.blobs.back().bytecode);
+    }
     // run optimizer passes
-    spirv_optimize(slang, out_spirv.blobs.back().bytecode);
+    const snippet_t& snippet = inp.snippets[snippet_index];
+    {
+        trace_span_t span("spirv_optimize", trace_args);
+        spirv_optimize(slang, relax_precision(args, snippet, slang), has_valued_defines(args, snippet), out_spirv.blobs.back().bytecode);
+    }
     return true;
 }
 
 // compile all shader-snippets into SPIRV bytecode
-spirv_t spirv_t::compile_glsl(const input_t& inp, slang_t::type_t slang, const std::vector<std::string>& defines) {
+spirv_t spirv_t::compile_glsl(const args_t& args, const input_t& inp, slang_t::type_t slang) {
+    initialize_spirv_tools();
     spirv_t out_spirv;
 
     // compile shader-snippets
     int snippet_index = 0;
     for (const snippet_t& snippet: inp.snippets) {
-        if (snippet.type == snippet_t::VS) {
+        if (snippet.specialized_only) {
+            // only used through specialized clones
+        }
+        else if (snippet.type == snippet_t::VS) {
             // vertex shader
-            std::string src = merge_source(inp, snippet, slang, defines);
-            if (!compile(EShLangVertex, slang, src, inp, snippet_index, out_spirv)) {
+            std::string src;
+            {
+                trace_span_t span("merge_source", {{ "snippet", snippet.name }, { "slang", slang_t::to_str(slang) }});
+                src = merge_source(inp, snippet, slang, args.defines);
+            }
+            if (!compile(args, EShLangVertex, slang, src, inp, snippet_index, out_spirv)) {
                 // spirv.errors contains error list
                 return out_spirv;
             }
         } else if (snippet.type == snippet_t::FS) {
             // fragment shader
-            std::string src = merge_source(inp, snippet, slang, defines);
-            if (!compile(EShLangFragment, slang, src, inp, snippet_index, out_spirv)) {
+            std::string src;
+            {
+                trace_span_t span("merge_source", {{ "snippet", snippet.name }, { "slang", slang_t::to_str(slang) }});
+                src = merge_source(inp, snippet, slang, args.defines);
+            }
+            if (!compile(args, EShLangFragment, slang, src, inp, snippet_index, out_spirv)) {
                 // spirv.errors contains error list
                 return out_spirv;
             }
         }
         snippet_index++;
     }
+    // optionally remove varyings which are not used by the fragment shader
+    if (args.link_opt) {
+        trace_span_t span("spirv_link_optimize", {{ "slang", slang_t::to_str(slang) }});
+        spirv_link_optimize(inp, slang, out_spirv);
+    }
     // when arriving here, no compile errors occurred
     // spirv.bytecodes array contains the SPIRV-bytecode
     // for each shader snippet
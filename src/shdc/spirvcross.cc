@@ -8,7 +8,10 @@
 #include "pystring.h"
 #include "spirv_hlsl.hpp"
 #include "spirv_msl.hpp"
+#include "spirv_parser.hpp"
 #include "tint/tint.h"
+#include "spirv-tools/libspirv.hpp"
+#include <set>
 
 #include "spirv_glsl.hpp"
 
@@ -33,11 +36,18 @@ using namespace spirv_cross;
 
 namespace shdc {
 
+void spirvcross_t::add_source(spirvcross_source_t&& src) {
+    assert(src.snippet_index >= 0);
+    if (src.snippet_index >= (int)source_index_by_snippet.size()) {
+        source_index_by_snippet.resize(src.snippet_index + 1, -1);
+    }
+    source_index_by_snippet[src.snippet_index] = (int)sources.size();
+    sources.push_back(std::move(src));
+}
+
 int spirvcross_t::find_source_by_snippet_index(int snippet_index) const {
-    for (int i = 0; i < (int)sources.size(); i++) {
-        if (sources[i].snippet_index == snippet_index) {
-            return i;
-        }
+    if ((snippet_index >= 0) && (snippet_index < (int)source_index_by_snippet.size())) {
+        return source_index_by_snippet[snippet_index];
     }
     return -1;
 }
@@ -59,7 +69,19 @@ static void fix_ub_matrix_force_colmajor(Compiler& compiler) {
     }
 }
 
-static void fix_bind_slots(Compiler& compiler, snippet_t::type_t type, slang_t::type_t slang) {
+// returns the globally allocated bind slot of a resource, or the next sequential slot
+static uint32_t bind_slot(const std::map<std::string, int>* global_slots, const std::string& name, uint32_t& inout_seq_slot) {
+    const uint32_t seq_slot = inout_seq_slot++;
+    if (global_slots) {
+        auto it = global_slots->find(name);
+        if (it != global_slots->end()) {
+            return (uint32_t)it->second;
+        }
+    }
+    return seq_slot;
+}
+
+static void fix_bind_slots(Compiler& compiler, snippet_t::type_t type, slang_t::type_t slang, const spirvcross_bind_slots_t& global_slots) {
     ShaderResources shader_resources = compiler.get_shader_resources();
 
     // uniform buffers
@@ -67,7 +89,7 @@ static void fix_bind_slots(Compiler& compiler, snippet_t::type_t type, slang_t::
         uint32_t binding = 0;
         for (const Resource& res: shader_resources.uniform_buffers) {
             compiler.set_decoration(res.id, spv::DecorationDescriptorSet, 0);
-            compiler.set_decoration(res.id, spv::DecorationBinding, binding++);
+            compiler.set_decoration(res.id, spv::DecorationBinding, bind_slot(global_slots.valid ? &global_slots.uniform_blocks : nullptr, res.name, binding));
         }
     }
 
@@ -85,7 +107,7 @@ static void fix_bind_slots(Compiler& compiler, snippet_t::type_t type, slang_t::
         uint32_t binding = 0;
         for (const Resource& res: shader_resources.separate_images) {
             compiler.set_decoration(res.id, spv::DecorationDescriptorSet, 0);
-            compiler.set_decoration(res.id, spv::DecorationBinding, binding++);
+            compiler.set_decoration(res.id, spv::DecorationBinding, bind_slot(global_slots.valid ? &global_slots.images : nullptr, res.name, binding));
         }
     }
 
@@ -94,11 +116,104 @@ static void fix_bind_slots(Compiler& compiler, snippet_t::type_t type, slang_t::
         uint32_t slot = 0;
         for (const Resource& res: shader_resources.separate_samplers) {
             compiler.set_decoration(res.id, spv::DecorationDescriptorSet, 0);
-            compiler.set_decoration(res.id, spv::DecorationBinding, slot++);
+            compiler.set_decoration(res.id, spv::DecorationBinding, bind_slot(global_slots.valid ? &global_slots.samplers : nullptr, res.name, slot));
         }
     }
 }
 
+// Allocate bind slots by resource name across all shaders (--global-bind-slots).
+// Each resource kind is a separate graph where resources used in the
+// same shader interfere with each other, the graph is colored greedily with
+// the most frequently used resources first. Since sokol-gfx requires the
+// slots of each shader stage to be continuous, a resource which would
+// leave a gap in a shader is reported as conflict.
+static errmsg_t allocate_slots(const input_t& inp,
+                               const char* kind,
+                               const std::vector<int>& snippet_indices,
+                               const std::vector<std::vector<std::string>>& shader_names,
+                               std::map<std::string, int>& out_slots)
+{
+    std::map<std::string, std::set<std::string>> neighbours;
+    std::map<std::string, int> use_count;
+    std::vector<std::string> order;     // in order of first appearance
+    for (const auto& names: shader_names) {
+        for (const std::string& name: names) {
+            if (use_count[name]++ == 0) {
+                order.push_back(name);
+            }
+            for (const std::string& other: names) {
+                if (other != name) {
+                    neighbours[name].insert(other);
+                }
+            }
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&use_count](const std::string& a, const std::string& b) {
+        return use_count[a] > use_count[b];
+    });
+    for (const std::string& name: order) {
+        int slot = 0;
+        bool taken = true;
+        while (taken) {
+            taken = false;
+            for (const std::string& other: neighbours[name]) {
+                auto it = out_slots.find(other);
+                if ((it != out_slots.end()) && (it->second == slot)) {
+                    taken = true;
+                    slot++;
+                    break;
+                }
+            }
+        }
+        out_slots[name] = slot;
+    }
+    for (int i = 0; i < (int)shader_names.size(); i++) {
+        const int num = (int)shader_names[i].size();
+        for (const std::string& name: shader_names[i]) {
+            if (out_slots[name] >= num) {
+                const snippet_t& snippet = inp.snippets[snippet_indices[i]];
+                const int line_index = snippet.lines.empty() ? 0 : snippet.lines[0];
+                return inp.error(line_index, fmt::format("global bind slot conflict: {} '{}' in shader '{}' needs slot {}, but the shader only uses {} {} slot(s) (sokol-gfx requires continuous bind slots)",
+                    kind, name, snippet.name, out_slots[name], num, kind));
+            }
+        }
+    }
+    return errmsg_t();
+}
+
+static errmsg_t allocate_global_bind_slots(const input_t& inp, const spirv_t& spirv, const std::vector<ParsedIR>& irs, spirvcross_bind_slots_t& out_slots) {
+    std::vector<int> snippet_indices;
+    std::vector<std::vector<std::string>> ub_names;
+    std::vector<std::vector<std::string>> img_names;
+    std::vector<std::vector<std::string>> smp_names;
+    for (size_t i = 0; i < spirv.blobs.size(); i++) {
+        Compiler compiler(irs[i]);
+        const ShaderResources shader_resources = compiler.get_shader_resources();
+        snippet_indices.push_back(spirv.blobs[i].snippet_index);
+        ub_names.emplace_back();
+        for (const Resource& res: shader_resources.uniform_buffers) {
+            ub_names.back().push_back(res.name);
+        }
+        img_names.emplace_back();
+        for (const Resource& res: shader_resources.separate_images) {
+            img_names.back().push_back(res.name);
+        }
+        smp_names.emplace_back();
+        for (const Resource& res: shader_resources.separate_samplers) {
+            smp_names.back().push_back(res.name);
+        }
+    }
+    errmsg_t err = allocate_slots(inp, "uniform block", snippet_indices, ub_names, out_slots.uniform_blocks);
+    if (!err.valid) {
+        err = allocate_slots(inp, "image", snippet_indices, img_names, out_slots.images);
+    }
+    if (!err.valid) {
+        err = allocate_slots(inp, "sampler", snippet_indices, smp_names, out_slots.samplers);
+    }
+    out_slots.valid = !err.valid;
+    return err;
+}
+
 // This directly patches the descriptor set and bindslot decorators in the input SPIRV
 // via SPIRVCross helper functions. This patched SPIRV is then used as input to Tint
 // for the SPIRV-to-WGSL translation.
@@ -191,8 +306,8 @@ static spirvcross_wgsl_symbol_table_t wgsl_patch_bind_slots(Compiler& compiler,
     return symbols;
 }
 
-static errmsg_t validate_uniform_blocks_and_separate_image_samplers(const input_t& inp, const spirv_blob_t& blob) {
-    CompilerGLSL compiler(blob.bytecode);
+static errmsg_t validate_uniform_blocks_and_separate_image_samplers(const input_t& inp, const ParsedIR& ir) {
+    Compiler compiler(ir);
     ShaderResources res = compiler.get_shader_resources();
     for (const Resource& ub_res: res.uniform_buffers) {
         const SPIRType& ub_type = compiler.get_type(ub_res.base_type_id);
@@ -334,8 +449,11 @@ static bool spirvtype_to_image_multisampled(const SPIRType& type) {
     return type.image.ms;
 }
 
+// gather the target-independent reflection info, this must be called after
+// compile() because the image and sampler usage analysis happens there
 static spirvcross_refl_t parse_reflection(const Compiler& compiler, slang_t::type_t slang) {
     assert(slang != slang_t::WGSL);
+    trace_span_t span("parse_reflection", {{ "slang", slang_t::to_str(slang) }});
     spirvcross_refl_t refl;
 
     ShaderResources shd_resources = compiler.get_shader_resources();
@@ -392,8 +510,32 @@ static spirvcross_refl_t parse_reflection(const Compiler& compiler, slang_t::typ
                 refl_uniform.array_count = m_type.array[0];
             }
             refl_uniform.offset = compiler.type_struct_member_offset(ub_type, m_index);
+            refl_uniform.active = false;
             refl_ub.uniforms.push_back(refl_uniform);
         }
+        // the byte range of members which are actually read by the shader
+        int active_end = 0;
+        for (const BufferRange& range: compiler.get_active_buffer_ranges(ub_res.id)) {
+            if (range.index < refl_ub.uniforms.size()) {
+                uniform_t& u = refl_ub.uniforms[range.index];
+                const int range_begin = (int)range.offset;
+                const int range_end = (int)(range.offset + range.range);
+                if (u.active) {
+                    const int end = std::max(u.active_offset + u.active_size, range_end);
+                    u.active_offset = std::min(u.active_offset, range_begin);
+                    u.active_size = end - u.active_offset;
+                }
+                else {
+                    u.active = true;
+                    u.active_offset = range_begin;
+                    u.active_size = range_end - range_begin;
+                }
+            }
+            active_end = std::max(active_end, (int)(range.offset + range.range));
+        }
+        if (active_end > 0) {
+            refl_ub.active_prefix_size = std::min(util::roundup(active_end, 16), util::roundup(refl_ub.size, 16));
+        }
         refl.uniform_blocks.push_back(refl_ub);
     }
     // (separate) images
@@ -425,7 +567,14 @@ static spirvcross_refl_t parse_reflection(const Compiler& compiler, slang_t::typ
         }
         refl.samplers.push_back(refl_smp);
     }
-    // combined image samplers
+    return refl;
+}
+
+// reflection of a cross-compiled shader, the target-independent part is only gathered
+// if no other shader language has compiled the snippet to identical SPIRV before,
+// the combined image samplers depend on the target language
+static spirvcross_refl_t parse_target_reflection(const Compiler& compiler, slang_t::type_t slang, const spirvcross_refl_t* base_refl) {
+    spirvcross_refl_t refl = base_refl ? *base_refl : parse_reflection(compiler, slang);
     for (auto& img_smp_res: compiler.get_combined_image_samplers()) {
         image_sampler_t refl_img_smp;
         refl_img_smp.slot = compiler.get_decoration(img_smp_res.combined_id, spv::DecorationBinding);
@@ -438,6 +587,7 @@ static spirvcross_refl_t parse_reflection(const Compiler& compiler, slang_t::typ
 }
 
 static spirvcross_refl_t wgsl_parse_reflection(const tint::Program* program, spirvcross_wgsl_symbol_table_t& symbols) {
+    trace_span_t span("parse_reflection", {{ "slang", slang_t::to_str(slang_t::WGSL) }});
     spirvcross_refl_t refl;
 
     auto inspector = tint::inspector::Inspector(program);
@@ -479,6 +629,8 @@ static spirvcross_refl_t wgsl_parse_reflection(const tint::Program* program, spi
         refl_ub.size = (int)ub.size;
         refl_ub.struct_name = symbols.uniform_block_struct_names[ub.binding];
         refl_ub.inst_name = symbols.uniform_block_inst_names[ub.binding];
+        // Tint doesn't expose per-member usage, treat the whole block as live
+        refl_ub.active_prefix_size = util::roundup(refl_ub.size, 16);
         refl.uniform_blocks.push_back(refl_ub);
     }
 
@@ -535,8 +687,8 @@ static spirvcross_refl_t wgsl_parse_reflection(const tint::Program* program, spi
     return refl;
 }
 
-static spirvcross_source_t to_glsl(const spirv_blob_t& blob, slang_t::type_t slang, uint32_t opt_mask, snippet_t::type_t type) {
-    CompilerGLSL compiler(blob.bytecode);
+static spirvcross_source_t to_glsl(const spirv_blob_t& blob, ParsedIR&& ir, slang_t::type_t slang, uint32_t opt_mask, snippet_t::type_t type, const spirvcross_bind_slots_t& global_slots, const spirvcross_refl_t* base_refl) {
+    CompilerGLSL compiler(std::move(ir));
     CompilerGLSL::Options options;
     options.emit_line_directives = false;
     switch (slang) {
@@ -561,7 +713,7 @@ static spirvcross_source_t to_glsl(const spirv_blob_t& blob, slang_t::type_t sla
     compiler.set_common_options(options);
     flatten_uniform_blocks(compiler);
     to_combined_image_samplers(compiler);
-    fix_bind_slots(compiler, type, slang);
+    fix_bind_slots(compiler, type, slang, global_slots);
     fix_ub_matrix_force_colmajor(compiler);
     std::string src = compiler.compile();
     spirvcross_source_t res;
@@ -569,13 +721,13 @@ static spirvcross_source_t to_glsl(const spirv_blob_t& blob, slang_t::type_t sla
     if (!src.empty()) {
         res.valid = true;
         res.source_code = std::move(src);
-        res.refl = parse_reflection(compiler, slang);
+        res.refl = parse_target_reflection(compiler, slang, base_refl);
     }
     return res;
 }
 
-static spirvcross_source_t to_hlsl(const spirv_blob_t& blob, slang_t::type_t slang, uint32_t opt_mask, snippet_t::type_t type) {
-    CompilerHLSL compiler(blob.bytecode);
+static spirvcross_source_t to_hlsl(const spirv_blob_t& blob, ParsedIR&& ir, slang_t::type_t slang, uint32_t opt_mask, snippet_t::type_t type, const spirvcross_bind_slots_t& global_slots, const spirvcross_refl_t* base_refl) {
+    CompilerHLSL compiler(std::move(ir));
     CompilerGLSL::Options commonOptions;
     commonOptions.emit_line_directives = false;
     commonOptions.vertex.fixup_clipspace = (0 != (opt_mask & option_t::FIXUP_CLIPSPACE));
@@ -592,7 +744,7 @@ static spirvcross_source_t to_hlsl(const spirv_blob_t& blob, slang_t::type_t sla
     }
     hlslOptions.point_size_compat = true;
     compiler.set_hlsl_options(hlslOptions);
-    fix_bind_slots(compiler, type, slang);
+    fix_bind_slots(compiler, type, slang, global_slots);
     fix_ub_matrix_force_colmajor(compiler);
     std::string src = compiler.compile();
     spirvcross_source_t res;
@@ -602,13 +754,13 @@ static spirvcross_source_t to_hlsl(const spirv_blob_t& blob, slang_t::type_t sla
         res.source_code = std::move(src);
         compiler.build_dummy_sampler_for_combined_images();
         to_combined_image_samplers(compiler);
-        res.refl = parse_reflection(compiler, slang);
+        res.refl = parse_target_reflection(compiler, slang, base_refl);
     }
     return res;
 }
 
-static spirvcross_source_t to_msl(const spirv_blob_t& blob, slang_t::type_t slang, uint32_t opt_mask, snippet_t::type_t type) {
-    CompilerMSL compiler(blob.bytecode);
+static spirvcross_source_t to_msl(const spirv_blob_t& blob, ParsedIR&& ir, slang_t::type_t slang, uint32_t opt_mask, snippet_t::type_t type, const spirvcross_bind_slots_t& global_slots, const spirvcross_refl_t* base_refl) {
+    CompilerMSL compiler(std::move(ir));
     CompilerGLSL::Options commonOptions;
     commonOptions.emit_line_directives = false;
     commonOptions.vertex.fixup_clipspace = (0 != (opt_mask & option_t::FIXUP_CLIPSPACE));
@@ -625,7 +777,7 @@ static spirvcross_source_t to_msl(const spirv_blob_t& blob, slang_t::type_t slan
     }
     mslOptions.enable_decoration_binding = true;
     compiler.set_msl_options(mslOptions);
-    fix_bind_slots(compiler, type, slang);
+    fix_bind_slots(compiler, type, slang, global_slots);
     std::string src = compiler.compile();
     spirvcross_source_t res;
     res.snippet_index = blob.snippet_index;
@@ -634,25 +786,31 @@ static spirvcross_source_t to_msl(const spirv_blob_t& blob, slang_t::type_t slan
         res.source_code = std::move(src);
         compiler.build_dummy_sampler_for_combined_images();
         to_combined_image_samplers(compiler);
-        res.refl = parse_reflection(compiler, slang);
-        // Metal's entry point function are called main0() because main() is reserved
-        res.refl.entry_point += "0";
+        res.refl = parse_target_reflection(compiler, slang, base_refl);
     }
     return res;
 }
 
-static spirvcross_source_t to_wgsl(const input_t& inp, const spirv_blob_t& blob, slang_t::type_t slang, uint32_t opt_mask, snippet_t::type_t type) {
+static spirvcross_source_t to_wgsl(const input_t& inp, const spirv_blob_t& blob, ParsedIR&& ir, slang_t::type_t slang, uint32_t opt_mask, snippet_t::type_t type) {
+    // Tint needs the bytecode with patched bind slots, the IR is only used to find the patch locations
     std::vector<uint32_t> bytecode = blob.bytecode;
-    Compiler compiler(blob.bytecode);
+    Compiler compiler(std::move(ir));
     spirvcross_wgsl_symbol_table_t symbols = wgsl_patch_bind_slots(compiler, type, bytecode);
     spirvcross_source_t res;
     res.snippet_index = blob.snippet_index;
     tint::reader::spirv::Options spirv_options;
     spirv_options.allow_non_uniform_derivatives = false; // FIXME?
-    tint::Program program = tint::reader::spirv::Parse(bytecode, spirv_options);
+    const trace_t::args_t trace_args = { { "snippet", inp.snippets[blob.snippet_index].name }, { "slang", slang_t::to_str(slang) } };
+    tint::Program program = [&]() {
+        trace_span_t span("tint_parse", trace_args);
+        return tint::reader::spirv::Parse(bytecode, spirv_options);
+    }();
     if (!program.Diagnostics().contains_errors()) {
         const tint::writer::wgsl::Options wgsl_options;
-        tint::writer::wgsl::Result result = tint::writer::wgsl::Generate(&program, wgsl_options);
+        tint::writer::wgsl::Result result = [&]() {
+            trace_span_t span("tint_generate", trace_args);
+            return tint::writer::wgsl::Generate(&program, wgsl_options);
+        }();
         if (result.success) {
             res.valid = true;
             res.source_code = result.wgsl;
@@ -666,42 +824,302 @@ static spirvcross_source_t to_wgsl(const input_t& inp, const spirv_blob_t& blob,
     return res;
 }
 
-static int find_unique_uniform_block_by_name(const spirvcross_t& spv_cross, const std::string& name) {
-    for (int i = 0; i < (int)spv_cross.unique_uniform_blocks.size(); i++) {
-        if (spv_cross.unique_uniform_blocks[i].struct_name == name) {
-            return i;
+/* The SPIRV output keeps the bind slots from fix_bind_slots() as binding
+   numbers, but moves resources into separate Vulkan descriptor sets, because
+   vertex- and fragment-shader resources share the same pipeline layout:
+
+    - set 0: vertex shader uniform blocks
+    - set 1: vertex shader images and samplers (samplers at image_t::NUM + slot)
+    - set 2: fragment shader uniform blocks
+    - set 3: fragment shader images and samplers (samplers at image_t::NUM + slot)
+*/
+static void spirv_patch_descriptor_sets(const Compiler& compiler, snippet_t::type_t type, std::vector<uint32_t>& inout_bytecode) {
+    ShaderResources shader_resources = compiler.get_shader_resources();
+    const uint32_t ub_set = (type == snippet_t::VS) ? 0 : 2;
+    const uint32_t resource_set = ub_set + 1;
+    auto patch = [&compiler, &inout_bytecode](const Resource& res, uint32_t set, uint32_t binding) {
+        uint32_t offset = 0;
+        if (compiler.get_binary_offset_for_decoration(res.id, spv::DecorationDescriptorSet, offset)) {
+            inout_bytecode[offset] = set;
+        }
+        if (compiler.get_binary_offset_for_decoration(res.id, spv::DecorationBinding, offset)) {
+            inout_bytecode[offset] = binding;
         }
+    };
+    for (const Resource& res: shader_resources.uniform_buffers) {
+        patch(res, ub_set, compiler.get_decoration(res.id, spv::DecorationBinding));
+    }
+    for (const Resource& res: shader_resources.separate_images) {
+        patch(res, resource_set, compiler.get_decoration(res.id, spv::DecorationBinding));
+    }
+    for (const Resource& res: shader_resources.separate_samplers) {
+        patch(res, resource_set, image_t::NUM + compiler.get_decoration(res.id, spv::DecorationBinding));
     }
-    return -1;
 }
 
-static int find_unique_image_by_name(const spirvcross_t& spv_cross, const std::string& name) {
-    for (int i = 0; i < (int)spv_cross.unique_images.size(); i++) {
-        if (spv_cross.unique_images[i].name == name) {
-            return i;
+static spirvcross_source_t to_spirv(const spirv_blob_t& blob, ParsedIR&& ir, slang_t::type_t slang, snippet_t::type_t type, const spirvcross_bind_slots_t& global_slots, const spirvcross_refl_t* base_refl) {
+    Compiler compiler(std::move(ir));
+    fix_bind_slots(compiler, type, slang, global_slots);
+    spirvcross_source_t res;
+    res.snippet_index = blob.snippet_index;
+    res.spirv = blob.bytecode;
+    spirv_patch_descriptor_sets(compiler, type, res.spirv);
+    spvtools::SpirvTools spirv_tools(SPV_ENV_VULKAN_1_0);
+    if (spirv_tools.Disassemble(res.spirv, &res.source_code, spvtools::SpirvTools::kDefaultDisassembleOption)) {
+        res.valid = true;
+        res.refl = parse_target_reflection(compiler, slang, base_refl);
+    }
+    return res;
+}
+
+/* Gather the declared base type and component count of each shader input,
+   and which components are actually read by the (optimized) shader code.
+   Components are tracked through loads followed by OpVectorShuffle,
+   OpCompositeExtract, or constant-index access chains, any other use of an
+   input (including dynamically indexed access chains) counts as reading all
+   components.
+*/
+static void spirv_reflect_input_components(const std::vector<uint32_t>& spirv, spirvcross_refl_t& refl) {
+    if (spirv.size() < 5) {
+        return;
+    }
+    struct input_var_t {
+        int location = -1;
+        attr_t::base_type_t base_type = attr_t::BASETYPE_INVALID;
+        int num_components = 0;
+        uint32_t used = 0;
+    };
+    std::map<uint32_t, uint32_t> locations;             // variable id => location
+    std::map<uint32_t, attr_t::base_type_t> scalar_types; // scalar type id => base type
+    std::map<uint32_t, std::pair<uint32_t, int>> vector_types; // vector type id => (component type id, count)
+    std::map<uint32_t, uint32_t> pointee_types;         // pointer type id => pointee type id
+    std::map<uint32_t, uint32_t> constants;             // constant id => 32-bit value
+    std::map<uint32_t, input_var_t> inputs;             // input variable id => info
+    std::map<uint32_t, uint32_t> loads;                 // loaded value id => input variable id
+    std::map<uint32_t, std::pair<uint32_t, uint32_t>> chains;    // access chain id => (input variable id, component mask)
+    bool in_function = false;
+    for (size_t pos = 5; pos < spirv.size();) {
+        const uint32_t* inst = &spirv[pos];
+        const uint32_t op = inst[0] & spv::OpCodeMask;
+        const uint32_t word_count = inst[0] >> spv::WordCountShift;
+        if ((word_count == 0) || ((pos + word_count) > spirv.size())) {
+            return;
+        }
+        pos += word_count;
+        if (op == spv::OpFunction) {
+            in_function = true;
+        }
+        if (!in_function) {
+            switch (op) {
+                case spv::OpDecorate:
+                    if ((word_count >= 4) && (inst[2] == spv::DecorationLocation)) {
+                        locations[inst[1]] = inst[3];
+                    }
+                    break;
+                case spv::OpTypeFloat:
+                    scalar_types[inst[1]] = attr_t::BASETYPE_FLOAT;
+                    break;
+                case spv::OpTypeInt:
+                    scalar_types[inst[1]] = (inst[3] != 0) ? attr_t::BASETYPE_INT : attr_t::BASETYPE_UINT;
+                    break;
+                case spv::OpTypeVector:
+                    vector_types[inst[1]] = std::make_pair(inst[2], (int)inst[3]);
+                    break;
+                case spv::OpTypePointer:
+                    pointee_types[inst[1]] = inst[3];
+                    break;
+                case spv::OpConstant:
+                    constants[inst[2]] = inst[3];
+                    break;
+                case spv::OpVariable:
+                    if ((inst[3] == spv::StorageClassInput) && (locations.count(inst[2]) > 0)) {
+                        const uint32_t type_id = pointee_types[inst[1]];
+                        input_var_t var;
+                        var.location = (int)locations[inst[2]];
+                        if (scalar_types.count(type_id) > 0) {
+                            var.base_type = scalar_types[type_id];
+                            var.num_components = 1;
+                        }
+                        else if ((vector_types.count(type_id) > 0) && (scalar_types.count(vector_types[type_id].first) > 0)) {
+                            var.base_type = scalar_types[vector_types[type_id].first];
+                            var.num_components = vector_types[type_id].second;
+                        }
+                        if (var.num_components > 0) {
+                            inputs[inst[2]] = var;
+                        }
+                    }
+                    break;
+                default:
+                    break;
+            }
+            continue;
+        }
+        // inside function bodies
+        if ((op == spv::OpLoad) && (word_count >= 4)) {
+            if (inputs.count(inst[3]) > 0) {
+                loads[inst[2]] = inst[3];
+                continue;
+            }
+            auto it = chains.find(inst[3]);
+            if (it != chains.end()) {
+                inputs[it->second.first].used |= it->second.second;
+                continue;
+            }
+        }
+        if (((op == spv::OpAccessChain) || (op == spv::OpInBoundsAccessChain)) && (word_count == 5) && (inputs.count(inst[3]) > 0)) {
+            auto it = constants.find(inst[4]);
+            if (it != constants.end()) {
+                chains[inst[2]] = std::make_pair(inst[3], 1u << (it->second & 3));
+                continue;
+            }
+        }
+        if ((op == spv::OpVectorShuffle) && (word_count >= 5)) {
+            const bool first = loads.count(inst[3]) > 0;
+            const bool second = loads.count(inst[4]) > 0;
+            if (first || second) {
+                const int num_first = first ? inputs[loads[inst[3]]].num_components : 0;
+                for (uint32_t i = 5; i < word_count; i++) {
+                    const uint32_t comp = inst[i];
+                    if (comp == 0xFFFFFFFF) {
+                        continue;
+                    }
+                    if (first && ((int)comp < num_first)) {
+                        inputs[loads[inst[3]]].used |= 1u << comp;
+                    }
+                    else if (second && ((int)comp >= num_first)) {
+                        inputs[loads[inst[4]]].used |= 1u << ((comp - num_first) & 3);
+                    }
+                }
+                continue;
+            }
+        }
+        if ((op == spv::OpCompositeExtract) && (word_count >= 5) && (loads.count(inst[3]) > 0)) {
+            inputs[loads[inst[3]]].used |= 1u << (inst[4] & 3);
+            continue;
+        }
+        // any other use reads all components, this includes access chains with
+        // a non-constant index and direct pointer uses of the input variable
+        // (e.g. OpCopyMemory or function call arguments), and conservatively
+        // also catches literal operands which happen to match a tracked id
+        for (uint32_t i = 1; i < word_count; i++) {
+            auto input_it = inputs.find(inst[i]);
+            if (input_it != inputs.end()) {
+                input_var_t& var = input_it->second;
+                var.used |= (1u << var.num_components) - 1;
+            }
+            auto load_it = loads.find(inst[i]);
+            if (load_it != loads.end()) {
+                input_var_t& var = inputs[load_it->second];
+                var.used |= (1u << var.num_components) - 1;
+            }
+            auto chain_it = chains.find(inst[i]);
+            if (chain_it != chains.end()) {
+                input_var_t& var = inputs[chain_it->second.first];
+                var.used |= (1u << var.num_components) - 1;
+            }
+        }
+    }
+    for (const auto& item: inputs) {
+        const input_var_t& var = item.second;
+        if ((var.location >= 0) && (var.location < attr_t::NUM) && (refl.inputs[var.location].slot >= 0)) {
+            attr_t& attr = refl.inputs[var.location];
+            attr.base_type = var.base_type;
+            attr.num_components = var.num_components;
+            attr.used_components = var.used & ((1u << var.num_components) - 1);
         }
     }
-    return -1;
 }
 
-static int find_unique_sampler_by_name(const spirvcross_t& spv_cross, const std::string& name) {
-    for (int i = 0; i < (int)spv_cross.unique_samplers.size(); i++) {
-        if (spv_cross.unique_samplers[i].name == name) {
-            return i;
+/* Gather fragment shader properties which affect early depth testing:
+   discard, depth writes, side-effecting stores and per-sample shading.
+*/
+static void spirv_reflect_fs_flags(const std::vector<uint32_t>& spirv, spirvcross_refl_t& refl) {
+    std::map<uint32_t, uint32_t> storage_classes;   // variable or access chain id => storage class
+    for (size_t pos = 5; pos < spirv.size();) {
+        const uint32_t* inst = &spirv[pos];
+        const uint32_t op = inst[0] & spv::OpCodeMask;
+        const uint32_t word_count = inst[0] >> spv::WordCountShift;
+        if ((word_count == 0) || ((pos + word_count) > spirv.size())) {
+            return;
+        }
+        pos += word_count;
+        switch (op) {
+            case spv::OpCapability:
+                if (inst[1] == spv::CapabilitySampleRateShading) {
+                    refl.sample_rate = true;
+                }
+                break;
+            case spv::OpExecutionMode:
+                if ((word_count >= 3) && (inst[2] == spv::ExecutionModeDepthReplacing)) {
+                    refl.writes_depth = true;
+                }
+                break;
+            case spv::OpDecorate:
+                if (word_count >= 3) {
+                    if (inst[2] == spv::DecorationSample) {
+                        refl.sample_rate = true;
+                    }
+                    else if ((inst[2] == spv::DecorationBuiltIn) && (word_count >= 4)) {
+                        if (inst[3] == spv::BuiltInFragDepth) {
+                            refl.writes_depth = true;
+                        }
+                        else if ((inst[3] == spv::BuiltInSampleId) || (inst[3] == spv::BuiltInSamplePosition)) {
+                            refl.sample_rate = true;
+                        }
+                    }
+                }
+                break;
+            case spv::OpVariable:
+                storage_classes[inst[2]] = inst[3];
+                break;
+            case spv::OpAccessChain:
+            case spv::OpInBoundsAccessChain:
+            case spv::OpImageTexelPointer:
+                if (storage_classes.count(inst[3]) > 0) {
+                    storage_classes[inst[2]] = storage_classes[inst[3]];
+                }
+                break;
+            case spv::OpStore:
+                if (storage_classes.count(inst[1]) > 0) {
+                    const uint32_t storage = storage_classes[inst[1]];
+                    if ((storage == spv::StorageClassStorageBuffer) ||
+                        (storage == spv::StorageClassUniform) ||
+                        (storage == spv::StorageClassImage))
+                    {
+                        refl.has_side_effects = true;
+                    }
+                }
+                break;
+            case spv::OpKill:
+            case spv::OpTerminateInvocation:
+            case spv::OpDemoteToHelperInvocation:
+                refl.uses_discard = true;
+                break;
+            default:
+                if ((op == spv::OpImageWrite) || ((op >= spv::OpAtomicLoad) && (op <= spv::OpAtomicXor) && (op != spv::OpAtomicLoad))) {
+                    refl.has_side_effects = true;
+                }
+                break;
         }
     }
-    return -1;
+}
+
+static int find_index_by_name(const std::unordered_map<std::string, int>& index, const std::string& name) {
+    auto it = index.find(name);
+    return (it != index.end()) ? it->second : -1;
 }
 
 // find all identical uniform blocks across all shaders, and check for collisions
 static bool gather_unique_uniform_blocks(const input_t& inp, spirvcross_t& spv_cross) {
+    trace_span_t span("gather_unique_uniform_blocks");
     for (spirvcross_source_t& src: spv_cross.sources) {
         for (uniform_block_t& ub: src.refl.uniform_blocks) {
-            int other_ub_index = find_unique_uniform_block_by_name(spv_cross, ub.struct_name);
+            int other_ub_index = find_index_by_name(spv_cross.unique_uniform_block_index_by_name, ub.struct_name);
             if (other_ub_index >= 0) {
                 if (ub.equals(spv_cross.unique_uniform_blocks[other_ub_index])) {
                     // identical uniform block already exists, take note of the index
                     ub.unique_index = other_ub_index;
+                    spv_cross.unique_uniform_blocks[other_ub_index].merge_active(ub);
                 }
                 else {
                     spv_cross.error = errmsg_t::error(inp.base_path, 0, fmt::format("conflicting uniform block definitions found for '{}'", ub.struct_name));
@@ -711,6 +1129,7 @@ static bool gather_unique_uniform_blocks(const input_t& inp, spirvcross_t& spv_c
             else {
                 // a new unique uniform block
                 ub.unique_index = (int) spv_cross.unique_uniform_blocks.size();
+                spv_cross.unique_uniform_block_index_by_name[ub.struct_name] = ub.unique_index;
                 spv_cross.unique_uniform_blocks.push_back(ub);
             }
         }
@@ -720,9 +1139,10 @@ static bool gather_unique_uniform_blocks(const input_t& inp, spirvcross_t& spv_c
 
 // find all identical images across all shaders, and check for collisions
 static bool gather_unique_images(const input_t& inp, spirvcross_t& spv_cross) {
+    trace_span_t span("gather_unique_images");
     for (spirvcross_source_t& src: spv_cross.sources) {
         for (image_t& img: src.refl.images) {
-            int other_img_index = find_unique_image_by_name(spv_cross, img.name);
+            int other_img_index = find_index_by_name(spv_cross.unique_image_index_by_name, img.name);
             if (other_img_index >= 0) {
                 if (img.equals(spv_cross.unique_images[other_img_index])) {
                     // identical image already exists, take note of the index
@@ -734,6 +1154,7 @@ static bool gather_unique_images(const input_t& inp, spirvcross_t& spv_cross) {
             } else {
                 // new unique image
                 img.unique_index = (int) spv_cross.unique_images.size();
+                spv_cross.unique_image_index_by_name[img.name] = img.unique_index;
                 spv_cross.unique_images.push_back(img);
             }
         }
@@ -743,9 +1164,10 @@ static bool gather_unique_images(const input_t& inp, spirvcross_t& spv_cross) {
 
 // find all identical samplers across all shaders, and check for collisions
 static bool gather_unique_samplers(const input_t& inp, spirvcross_t& spv_cross) {
+    trace_span_t span("gather_unique_samplers");
     for (spirvcross_source_t& src: spv_cross.sources) {
         for (sampler_t& smp: src.refl.samplers) {
-            int other_smp_index = find_unique_sampler_by_name(spv_cross, smp.name);
+            int other_smp_index = find_index_by_name(spv_cross.unique_sampler_index_by_name, smp.name);
             if (other_smp_index >= 0) {
                 if (smp.equals(spv_cross.unique_samplers[other_smp_index])) {
                     // identical sampler already exists, take note of the index
@@ -757,6 +1179,7 @@ static bool gather_unique_samplers(const input_t& inp, spirvcross_t& spv_cross)
             } else {
                 // new unique sampler
                 smp.unique_index = (int) spv_cross.unique_samplers.size();
+                spv_cross.unique_sampler_index_by_name[smp.name] = smp.unique_index;
                 spv_cross.unique_samplers.push_back(smp);
             }
         }
@@ -791,40 +1214,117 @@ static errmsg_t validate_linking(const input_t& inp, const spirvcross_t& spv_cro
     return errmsg_t();
 }
 
-spirvcross_t spirvcross_t::translate(const input_t& inp, const spirv_t& spirv, slang_t::type_t slang) {
+// hash the global bind slot assignment of a shader language, the slots are
+// part of the cached reflection, so that shader languages which compiled a
+// snippet to identical SPIRV but assigned different global slots (because
+// other snippets have language-specific resources) don't share reflection
+static uint64_t hash_bind_slots(const spirvcross_bind_slots_t& slots) {
+    uint64_t hash = util::fnv1a64(nullptr, 0);
+    if (!slots.valid) {
+        return hash;
+    }
+    for (const auto* map: { &slots.uniform_blocks, &slots.images, &slots.samplers }) {
+        for (const auto& item: *map) {
+            const std::string str = fmt::format("{}={};", item.first, item.second);
+            hash = util::fnv1a64(str.data(), str.size(), hash);
+        }
+        hash = util::fnv1a64("|", 1, hash);
+    }
+    return hash;
+}
+
+// parse a SPIRV blob once into an IR which is shared by all SPIRV-Cross
+// compiler instances created for the blob
+static ParsedIR parse_spirv(const input_t& inp, const spirv_blob_t& blob, slang_t::type_t slang) {
+    trace_span_t span("spirv_parse", {{ "snippet", inp.snippets[blob.snippet_index].name }, { "slang", slang_t::to_str(slang) }});
+    Parser parser(blob.bytecode.data(), blob.bytecode.size());
+    parser.parse();
+    return std::move(parser.get_parsed_ir());
+}
+
+spirvcross_t spirvcross_t::translate(const args_t& args, const input_t& inp, const spirv_t& spirv, slang_t::type_t slang, spirvcross_refl_cache_t& refl_cache) {
     spirvcross_t spv_cross;
-    for (const auto& blob: spirv.blobs) {
+    std::vector<ParsedIR> irs;
+    irs.reserve(spirv.blobs.size());
+    for (const spirv_blob_t& blob: spirv.blobs) {
+        irs.push_back(parse_spirv(inp, blob, slang));
+    }
+    // WGSL has its own hardwired bind slot scheme, see wgsl_patch_bind_slots()
+    spirvcross_bind_slots_t global_slots;
+    if (args.global_bind_slots && (slang != slang_t::WGSL)) {
+        spv_cross.error = allocate_global_bind_slots(inp, spirv, irs, global_slots);
+        if (spv_cross.error.valid) {
+            return spv_cross;
+        }
+    }
+    const uint64_t slots_hash = hash_bind_slots(global_slots);
+    for (size_t blob_index = 0; blob_index < spirv.blobs.size(); blob_index++) {
+        const spirv_blob_t& blob = spirv.blobs[blob_index];
+        ParsedIR& ir = irs[blob_index];
         spirvcross_source_t src;
         uint32_t opt_mask = inp.snippets[blob.snippet_index].options[(int)slang];
         snippet_t::type_t type = inp.snippets[blob.snippet_index].type;
         assert((type == snippet_t::VS) || (type == snippet_t::FS));
-        spv_cross.error = validate_uniform_blocks_and_separate_image_samplers(inp, blob);
+        spv_cross.error = validate_uniform_blocks_and_separate_image_samplers(inp, ir);
         if (spv_cross.error.valid) {
             return spv_cross;
         }
-        switch (slang) {
-            case slang_t::GLSL330:
-            case slang_t::GLSL100:
-            case slang_t::GLSL300ES:
-                src = to_glsl(blob, slang, opt_mask, type);
-                break;
-            case slang_t::HLSL4:
-            case slang_t::HLSL5:
-                src = to_hlsl(blob, slang, opt_mask, type);
-                break;
-            case slang_t::METAL_MACOS:
-            case slang_t::METAL_IOS:
-            case slang_t::METAL_SIM:
-                src = to_msl(blob, slang, opt_mask, type);
-                break;
-            case slang_t::WGSL:
-                src = to_wgsl(inp, blob, slang, opt_mask, type);
-                break;
-            default: break;
+        // shader languages which compiled the snippet to identical SPIRV with
+        // the same global bind slots share the target-independent reflection
+        // (WGSL reflection comes from Tint)
+        const uint64_t refl_hash = util::fnv1a64(blob.bytecode.data(), blob.bytecode.size() * sizeof(uint32_t), slots_hash);
+        const spirvcross_refl_cache_t::key_t refl_key(blob.snippet_index, refl_hash);
+        const spirvcross_refl_t* base_refl = nullptr;
+        if (slang != slang_t::WGSL) {
+            auto it = refl_cache.items.find(refl_key);
+            if (it != refl_cache.items.end()) {
+                base_refl = &it->second;
+            }
+        }
+        {
+            trace_span_t span("spirvcross_translate", {{ "snippet", inp.snippets[blob.snippet_index].name }, { "slang", slang_t::to_str(slang) }});
+            switch (slang) {
+                case slang_t::GLSL330:
+                case slang_t::GLSL100:
+                case slang_t::GLSL300ES:
+                    src = to_glsl(blob, std::move(ir), slang, opt_mask, type, global_slots, base_refl);
+                    break;
+                case slang_t::HLSL4:
+                case slang_t::HLSL5:
+                    src = to_hlsl(blob, std::move(ir), slang, opt_mask, type, global_slots, base_refl);
+                    break;
+                case slang_t::METAL_MACOS:
+                case slang_t::METAL_IOS:
+                case slang_t::METAL_SIM:
+                    src = to_msl(blob, std::move(ir), slang, opt_mask, type, global_slots, base_refl);
+                    break;
+                case slang_t::WGSL:
+                    src = to_wgsl(inp, blob, std::move(ir), slang, opt_mask, type);
+                    break;
+                case slang_t::SPIRV:
+                    src = to_spirv(blob, std::move(ir), slang, type, global_slots, base_refl);
+                    break;
+                default: break;
+            }
         }
         if (src.valid) {
             assert(src.snippet_index == blob.snippet_index);
-            spv_cross.sources.push_back(std::move(src));
+            if (!base_refl) {
+                spirv_reflect_input_components(blob.bytecode, src.refl);
+                if (type == snippet_t::FS) {
+                    spirv_reflect_fs_flags(blob.bytecode, src.refl);
+                }
+                if (slang != slang_t::WGSL) {
+                    spirvcross_refl_t& cached_refl = refl_cache.items[refl_key];
+                    cached_refl = src.refl;
+                    cached_refl.image_samplers.clear();
+                }
+            }
+            // Metal's entry point function are called main0() because main() is reserved
+            if (slang_t::is_msl(slang)) {
+                src.refl.entry_point += "0";
+            }
+            spv_cross.add_source(std::move(src));
         }
         else {
             const int line_index = inp.snippets[blob.snippet_index].lines[0];
@@ -837,18 +1337,19 @@ spirvcross_t spirvcross_t::translate(const input_t& inp, const spirv_t& spirv, s
             spv_cross.error = inp.error(line_index, err_msg);
             return spv_cross;
         }
-        if (!gather_unique_uniform_blocks(inp, spv_cross)) {
-            // error has been set in spv_cross.error
-            return spv_cross;
-        }
-        if (!gather_unique_images(inp, spv_cross)) {
-            // error has been set in spv_cross.error
-            return spv_cross;
-        }
-        if (!gather_unique_samplers(inp, spv_cross)) {
-            // error has been set in spv_cross.error
-            return spv_cross;
-        }
+    }
+    // gather unique resources once after all snippets have been translated
+    if (!gather_unique_uniform_blocks(inp, spv_cross)) {
+        // error has been set in spv_cross.error
+        return spv_cross;
+    }
+    if (!gather_unique_images(inp, spv_cross)) {
+        // error has been set in spv_cross.error
+        return spv_cross;
+    }
+    if (!gather_unique_samplers(inp, spv_cross)) {
+        // error has been set in spv_cross.error
+        return spv_cross;
     }
     // check that vertex-shader outputs match their fragment shader inputs
     errmsg_t err = validate_linking(inp, spv_cross);
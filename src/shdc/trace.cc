@@ -0,0 +1,73 @@
+/*
+    phase timing instrumentation, written in Chrome trace-event format
+    (load into chrome://tracing or https://ui.perfetto.dev)
+*/
+#include "shdc.h"
+#include "fmt/format.h"
+#include <stdio.h>
+#include <chrono>
+
+namespace shdc {
+
+bool trace_t::enabled = false;
+std::vector<trace_t::event_t> trace_t::events;
+
+uint64_t trace_t::now_us() {
+    static const auto start = std::chrono::steady_clock::now();
+    return (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void trace_t::add(const std::string& name, const args_t& args, uint64_t start_us) {
+    event_t event;
+    event.name = name;
+    event.args = args;
+    event.start_us = start_us;
+    event.duration_us = now_us() - start_us;
+    events.push_back(std::move(event));
+}
+
+trace_span_t::trace_span_t(const std::string& name_, trace_t::args_t args_) {
+    if (trace_t::enabled) {
+        active = true;
+        name = name_;
+        args = std::move(args_);
+        start_us = trace_t::now_us();
+    }
+}
+
+trace_span_t::~trace_span_t() {
+    end();
+}
+
+void trace_span_t::end() {
+    if (active) {
+        active = false;
+        trace_t::add(name, args, start_us);
+    }
+}
+
+errmsg_t trace_t::write(const std::string& path) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) {
+        return errmsg_t::error(path, 0, fmt::format("failed to open trace file '{}'", path));
+    }
+    fmt::print(f, "{{\"traceEvents\":[\n");
+    for (size_t i = 0; i < events.size(); i++) {
+        const event_t& event = events[i];
+        std::string args_str;
+        for (const auto& arg: event.args) {
+            if (!args_str.empty()) {
+                args_str += ",";
+            }
+            args_str += fmt::format("\"{}\":\"{}\"", util::json_escape(arg.first), util::json_escape(arg.second));
+        }
+        fmt::print(f, "  {{\"name\":\"{}\",\"cat\":\"shdc\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":{},\"dur\":{},\"args\":{{{}}}}}{}\n",
+            util::json_escape(event.name), event.start_us, event.duration_us, args_str,
+            (i < (events.size() - 1)) ? "," : "");
+    }
+    fmt::print(f, "],\"displayTimeUnit\":\"ms\"}}\n");
+    fclose(f);
+    return errmsg_t();
+}
+
+} // namespace shdc
@@ -4,6 +4,7 @@
 #include "shdc.h"
 #include "fmt/format.h"
 #include "pystring.h"
+#include <ctype.h>
 
 namespace shdc {
 namespace util {
@@ -76,6 +77,69 @@ int uniform_size(uniform_t::type_t type, int array_size) {
     }
 }
 
+int uniform_align(uniform_t::type_t type, int array_size) {
+    if (array_size > 1) {
+        return 16;
+    }
+    switch (type) {
+        case uniform_t::FLOAT:
+        case uniform_t::INT:
+            return 4;
+        case uniform_t::FLOAT2:
+        case uniform_t::INT2:
+            return 8;
+        default:
+            return 16;
+    }
+}
+
+int std140_layout(const std::vector<std140_member_t>& members, const std::vector<int>& order, std::vector<int>& out_offsets) {
+    out_offsets.resize(members.size());
+    int cur_offset = 0;
+    for (int index: order) {
+        const std140_member_t& m = members[index];
+        cur_offset = roundup(cur_offset, m.align);
+        out_offsets[index] = cur_offset;
+        cur_offset += m.size;
+    }
+    return roundup(cur_offset, 16);
+}
+
+/* Greedy std140 packing: 16-byte aligned members with a size multiple of 16
+   go first, each vec3 is followed by a scalar which fills its 4-byte tail,
+   then vec2s are paired and remaining scalars fill the rest. The relative
+   order within each group is preserved, so the result is deterministic.
+*/
+std::vector<int> std140_packed_order(const std::vector<std140_member_t>& members) {
+    std::vector<int> full, vec3s, vec2s, scalars;
+    for (int i = 0; i < (int)members.size(); i++) {
+        const std140_member_t& m = members[i];
+        if ((m.size == 12) && (m.align == 16)) {
+            vec3s.push_back(i);
+        }
+        else if ((m.size == 8) && (m.align == 8)) {
+            vec2s.push_back(i);
+        }
+        else if ((m.size == 4) && (m.align == 4)) {
+            scalars.push_back(i);
+        }
+        else {
+            full.push_back(i);
+        }
+    }
+    std::vector<int> order = full;
+    size_t scalar_index = 0;
+    for (int index: vec3s) {
+        order.push_back(index);
+        if (scalar_index < scalars.size()) {
+            order.push_back(scalars[scalar_index++]);
+        }
+    }
+    order.insert(order.end(), vec2s.begin(), vec2s.end());
+    order.insert(order.end(), scalars.begin() + scalar_index, scalars.end());
+    return order;
+}
+
 int roundup(int val, int round_to) {
     return (val + (round_to - 1)) & ~(round_to - 1);
 }
@@ -98,6 +162,15 @@ const uniform_block_t* find_uniform_block_by_slot(const spirvcross_refl_t& refl,
     return nullptr;
 }
 
+const uniform_block_t* find_uniform_block_by_name(const spirvcross_refl_t& refl, const std::string& struct_name) {
+    for (const uniform_block_t& ub: refl.uniform_blocks) {
+        if (ub.struct_name == struct_name) {
+            return &ub;
+        }
+    }
+    return nullptr;
+}
+
 const image_t* find_image_by_slot(const spirvcross_refl_t& refl, int slot) {
     for (const image_t& img: refl.images) {
         if (img.slot == slot) {
@@ -207,5 +280,142 @@ std::string replace_C_comment_tokens(const std::string& str) {
     return s;
 }
 
+// escape a string for use inside a JSON string literal
+std::string json_escape(const std::string& str) {
+    std::string res;
+    res.reserve(str.size());
+    for (const char c: str) {
+        switch (c) {
+            case '"':  res += "\\\""; break;
+            case '\\': res += "\\\\"; break;
+            case '\b': res += "\\b"; break;
+            case '\f': res += "\\f"; break;
+            case '\n': res += "\\n"; break;
+            case '\r': res += "\\r"; break;
+            case '\t': res += "\\t"; break;
+            default:
+                if ((uint8_t)c < 0x20) {
+                    res += fmt::format("\\u{:04x}", (uint8_t)c);
+                }
+                else {
+                    res += c;
+                }
+                break;
+        }
+    }
+    return res;
+}
+
+// 64-bit FNV-1a hash, pass the result of a previous call to hash more data
+uint64_t fnv1a64(const void* data, size_t size, uint64_t hash) {
+    const uint8_t* ptr = (const uint8_t*) data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= ptr[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static uint64_t hash_str(const std::string& str, uint64_t hash) {
+    // include the terminating zero so that 'ab'+'c' and 'a'+'bc' hash differently
+    return fnv1a64(str.c_str(), str.length() + 1, hash);
+}
+
+// hash ints as 4 little-endian bytes, so that the hash doesn't depend on
+// the endianness of the machine running sokol-shdc
+static uint64_t hash_int(int val, uint64_t hash) {
+    const uint32_t u = (uint32_t)val;
+    const uint8_t bytes[4] = { (uint8_t)u, (uint8_t)(u >> 8), (uint8_t)(u >> 16), (uint8_t)(u >> 24) };
+    return fnv1a64(bytes, sizeof(bytes), hash);
+}
+
+static uint64_t hash_stage(const spirvcross_source_t* src, const bytecode_blob_t* blob, uint64_t hash) {
+    if (blob) {
+        hash = fnv1a64(blob->data.data(), blob->data.size(), hash);
+    }
+    else {
+        hash = hash_str(src->source_code, hash);
+    }
+    const spirvcross_refl_t& refl = src->refl;
+    hash = hash_str(refl.entry_point, hash);
+    for (const uniform_block_t& ub: refl.uniform_blocks) {
+        hash = hash_int(ub.slot, hash);
+        hash = hash_int(ub.size, hash);
+        hash = hash_int(ub.flattened ? 1 : 0, hash);
+        for (const uniform_t& u: ub.uniforms) {
+            hash = hash_str(u.name, hash);
+            hash = hash_int((int)u.type, hash);
+            hash = hash_int(u.array_count, hash);
+            hash = hash_int(u.offset, hash);
+        }
+    }
+    for (const image_t& img: refl.images) {
+        hash = hash_int(img.slot, hash);
+        hash = hash_int((int)img.type, hash);
+        hash = hash_int((int)img.sample_type, hash);
+        hash = hash_int(img.multisampled ? 1 : 0, hash);
+    }
+    for (const sampler_t& smp: refl.samplers) {
+        hash = hash_int(smp.slot, hash);
+        hash = hash_int((int)smp.type, hash);
+    }
+    for (const image_sampler_t& img_smp: refl.image_samplers) {
+        hash = hash_int(img_smp.slot, hash);
+        hash = hash_str(img_smp.name, hash);
+        hash = hash_str(img_smp.image_name, hash);
+        hash = hash_str(img_smp.sampler_name, hash);
+    }
+    return hash;
+}
+
+// content hash of a program for one shader language, covering the shader
+// code and everything in the reflection which ends up in sg_shader_desc
+uint64_t program_hash(const program_t& prog, const input_t& inp, const spirvcross_t& spirvcross, const bytecode_t& bytecode, slang_t::type_t slang) {
+    const spirvcross_source_t* vs_src = find_spirvcross_source_by_shader_name(prog.vs_name, inp, spirvcross);
+    const spirvcross_source_t* fs_src = find_spirvcross_source_by_shader_name(prog.fs_name, inp, spirvcross);
+    assert(vs_src && fs_src);
+    uint64_t hash = hash_str(slang_t::to_str(slang), fnv1a64(nullptr, 0));
+    for (const attr_t& attr: vs_src->refl.inputs) {
+        if (attr.slot >= 0) {
+            hash = hash_int(attr.slot, hash);
+            hash = hash_str(attr.name, hash);
+            hash = hash_str(attr.sem_name, hash);
+            hash = hash_int(attr.sem_index, hash);
+        }
+    }
+    hash = hash_stage(vs_src, find_bytecode_blob_by_shader_name(prog.vs_name, inp, bytecode), hash);
+    hash = hash_stage(fs_src, find_bytecode_blob_by_shader_name(prog.fs_name, inp, bytecode), hash);
+    return hash;
+}
+
+// check for 'NAME' or 'NAME=VALUE', where NAME is a valid identifier
+bool is_valid_define(const std::string& define) {
+    const std::string::size_type eq = define.find('=');
+    const std::string name = define.substr(0, eq);
+    if (name.empty() || isdigit((unsigned char)name[0])) {
+        return false;
+    }
+    for (const char c: name) {
+        if (!(isalnum((unsigned char)c) || (c == '_'))) {
+            return false;
+        }
+    }
+    if ((eq != std::string::npos) && (eq + 1 == define.length())) {
+        return false;
+    }
+    return true;
+}
+
+// 'NAME' => '#define NAME (1)', 'NAME=VALUE' => '#define NAME (VALUE)'
+std::string define_to_glsl(const std::string& define) {
+    const std::string::size_type eq = define.find('=');
+    if (eq == std::string::npos) {
+        return fmt::format("#define {} (1)\n", define);
+    }
+    else {
+        return fmt::format("#define {} ({})\n", define.substr(0, eq), define.substr(eq + 1));
+    }
+}
+
 } // namespace util
 } // namespace shdc
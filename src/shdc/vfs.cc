@@ -0,0 +1,128 @@
+/*
+    include resolver backends for the filesystem, in-memory files and
+    shader source pack files
+*/
+#include "shdc.h"
+#include "fmt/format.h"
+#include "pystring.h"
+#include <stdio.h>
+#include <string.h>
+#include <memory>
+
+namespace shdc {
+
+// pack file layout, all integers are little-endian uint32:
+//
+//  "SHDCPAK1"
+//  num_files
+//  num_files * { path_len, content_len, path bytes, content bytes }
+//
+static const char pack_magic[8] = { 'S', 'H', 'D', 'C', 'P', 'A', 'K', '1' };
+
+static bool load_file(const std::string& path, std::string& out_content) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    const size_t file_size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    out_content.resize(file_size);
+    const size_t num_read = fread((void*)out_content.data(), 1, file_size, f);
+    fclose(f);
+    out_content.resize(num_read);
+    return true;
+}
+
+static bool read_u32(const std::string& data, size_t& pos, uint32_t& out_val) {
+    if ((pos + 4) > data.size()) {
+        return false;
+    }
+    const uint8_t* ptr = (const uint8_t*) &data[pos];
+    out_val = (uint32_t)ptr[0] | ((uint32_t)ptr[1] << 8) | ((uint32_t)ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+    pos += 4;
+    return true;
+}
+
+include_resolver_t vfs_t::file_resolver() {
+    return load_file;
+}
+
+// the file map is shared between copies of the resolver
+include_resolver_t vfs_t::memory_resolver(files_t files) {
+    files_t normalized;
+    for (auto& item: files) {
+        normalized[normalize_path(item.first)] = std::move(item.second);
+    }
+    std::shared_ptr<const files_t> shared = std::make_shared<const files_t>(std::move(normalized));
+    return [shared](const std::string& path, std::string& out_content) -> bool {
+        auto it = shared->find(normalize_path(path));
+        if (it == shared->end()) {
+            return false;
+        }
+        out_content = it->second;
+        return true;
+    };
+}
+
+errmsg_t vfs_t::load_pack(const std::string& pack_path, files_t& out_files) {
+    trace_span_t span("load_pack", {{ "file", pack_path }});
+    std::string data;
+    if (!load_file(pack_path, data)) {
+        return errmsg_t::error(pack_path, -1, fmt::format("Failed to open pack file '{}'", pack_path));
+    }
+    if ((data.size() < sizeof(pack_magic)) || (0 != memcmp(data.data(), pack_magic, sizeof(pack_magic)))) {
+        return errmsg_t::error(pack_path, -1, fmt::format("'{}' is not a shader source pack file", pack_path));
+    }
+    size_t pos = sizeof(pack_magic);
+    uint32_t num_files = 0;
+    if (!read_u32(data, pos, num_files)) {
+        return errmsg_t::error(pack_path, -1, fmt::format("Truncated pack file '{}'", pack_path));
+    }
+    for (uint32_t i = 0; i < num_files; i++) {
+        uint32_t path_len = 0;
+        uint32_t content_len = 0;
+        if (!read_u32(data, pos, path_len) || !read_u32(data, pos, content_len) || ((pos + path_len + content_len) > data.size())) {
+            return errmsg_t::error(pack_path, -1, fmt::format("Truncated pack file '{}'", pack_path));
+        }
+        std::string path = normalize_path(data.substr(pos, path_len));
+        pos += path_len;
+        out_files[path] = data.substr(pos, content_len);
+        pos += content_len;
+    }
+    return errmsg_t();
+}
+
+errmsg_t vfs_t::pack_resolver(const std::string& pack_path, include_resolver_t& out_resolver) {
+    files_t files;
+    errmsg_t err = load_pack(pack_path, files);
+    if (err.valid) {
+        return err;
+    }
+    out_resolver = memory_resolver(std::move(files));
+    return errmsg_t();
+}
+
+// convert to forward slashes and remove '.', '..' and empty path components,
+// so that lookups don't depend on how an @include path was joined
+std::string vfs_t::normalize_path(const std::string& path) {
+    std::string str = pystring::replace(path, "\\", "/");
+    std::vector<std::string> parts;
+    pystring::split(str, parts, "/");
+    std::vector<std::string> res;
+    for (const std::string& part: parts) {
+        if (part.empty() || (part == ".")) {
+            continue;
+        }
+        if ((part == "..") && !res.empty() && (res.back() != "..")) {
+            res.pop_back();
+        }
+        else {
+            res.push_back(part);
+        }
+    }
+    const std::string joined = pystring::join("/", res);
+    return pystring::startswith(str, "/") ? ("/" + joined) : joined;
+}
+
+} // namespace shdc
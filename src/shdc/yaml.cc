@@ -53,6 +53,9 @@ static void write_attribute(const attr_t& att) {
     L("              name: {}\n", att.name);
     L("              sem_name: {}\n", att.sem_name);
     L("              sem_index: {}\n", att.sem_index);
+    L("              base_type: {}\n", attr_t::base_type_to_str(att.base_type));
+    L("              num_components: {}\n", att.num_components);
+    L("              used_components: {}\n", att.used_components);
 }
 
 static void write_uniform(const uniform_t& uniform);
@@ -60,6 +63,7 @@ static void write_uniform_block(const uniform_block_t& uniform_block) {
     L("            -\n");
     L("              slot: {}\n", uniform_block.slot);
     L("              size: {}\n", uniform_block.size);
+    L("              active_prefix_size: {}\n", uniform_block.active_prefix_size);
     L("              struct_name: {}\n", uniform_block.struct_name);
     L("              inst_name: {}\n", uniform_block.inst_name);
     L("              uniforms:\n");
@@ -81,6 +85,9 @@ static void write_uniform(const uniform_t& uniform) {
     L("                  type: {}\n", uniform_t::type_to_str(uniform.type));
     L("                  array_count: {}\n", uniform.array_count);
     L("                  offset: {}\n", uniform.offset);
+    L("                  active: {}\n", uniform.active);
+    L("                  active_offset: {}\n", uniform.active_offset);
+    L("                  active_size: {}\n", uniform.active_size);
 }
 
 static void write_image(const image_t& image) {
@@ -109,6 +116,12 @@ static void write_image_sampler(const image_sampler_t& image_sampler) {
 
 static void write_source_reflection(const spirvcross_source_t* src) {
     L("          entry_point: {}\n", src->refl.entry_point);
+    if (src->refl.stage == stage_t::FS) {
+        L("          uses_discard: {}\n", src->refl.uses_discard);
+        L("          writes_depth: {}\n", src->refl.writes_depth);
+        L("          has_side_effects: {}\n", src->refl.has_side_effects);
+        L("          sample_rate: {}\n", src->refl.sample_rate);
+    }
     L("          inputs:\n");
     for (const auto& input: src->refl.inputs) {
         if (input.slot == -1) {
@@ -176,26 +189,28 @@ static errmsg_t write_shader_sources_and_blobs(const args_t& args,
         const bytecode_blob_t* fs_blob = find_bytecode_blob_by_shader_name(prog.fs_name, inp, bytecode);
 
         const std::string file_path_base = fmt::format("{}_{}{}_{}", args.output, mod_prefix(inp), prog.name, slang_t::to_str(slang));
-        const std::string file_path_vs = fmt::format("{}_vs{}", file_path_base, bare_t::slang_file_extension(slang, vs_blob));
-        const std::string file_path_fs = fmt::format("{}_fs{}", file_path_base, bare_t::slang_file_extension(slang, fs_blob));
+        const bool vs_is_binary = (vs_blob != nullptr) || !vs_src->spirv.empty();
+        const bool fs_is_binary = (fs_blob != nullptr) || !fs_src->spirv.empty();
+        const std::string file_path_vs = fmt::format("{}_vs{}", file_path_base, bare_t::slang_file_extension(slang, vs_is_binary));
+        const std::string file_path_fs = fmt::format("{}_fs{}", file_path_base, bare_t::slang_file_extension(slang, fs_is_binary));
 
         L("      -\n");
         L("        name: {}\n", prog.name);
         L("        vs:\n");
         L("          path: {}\n", file_path_vs);
-        L("          is_binary: {}\n", vs_blob != nullptr);
+        L("          is_binary: {}\n", vs_is_binary);
         write_source_reflection(vs_src);
 
         L("        fs:\n");
         L("          path: {}\n", file_path_fs);
-        L("          is_binary: {}\n", fs_blob != nullptr);
+        L("          is_binary: {}\n", fs_is_binary);
         write_source_reflection(fs_src);
     }
 
     return errmsg_t();
 }
 
-errmsg_t yaml_t::gen(const args_t& args, const input_t& inp, const std::array<spirvcross_t,slang_t::NUM>& spirvcross, const std::array<bytecode_t,slang_t::NUM>& bytecode)
+errmsg_t yaml_t::gen(const args_t& args, const input_t& inp, const std::array<spirvcross_t,slang_t::NUM>& spirvcross, const std::array<bytecode_t,slang_t::NUM>& bytecode, output_t& out)
 {
     // first write everything into a string, and only when no errors occur,
     // dump this into a file (so we don't have half-written files lying around)
@@ -220,14 +235,8 @@ errmsg_t yaml_t::gen(const args_t& args, const input_t& inp, const std::array<sp
         }
     }
 
-    // write result into output file
-    const std::string file_path = fmt::format("{}_{}reflection.yaml", args.output, mod_prefix(inp));
-    FILE* f = fopen(file_path.c_str(), "w");
-    if (!f) {
-        return errmsg_t::error(inp.base_path, 0, fmt::format("failed to open output file '{}'", args.output));
-    }
-    fwrite(file_content.c_str(), file_content.length(), 1, f);
-    fclose(f);
+    // add result to output files
+    out.add(fmt::format("{}_{}reflection.yaml", args.output, mod_prefix(inp)), file_content);
 
     return errmsg_t();
 }
@@ -0,0 +1,32 @@
+// vertex attributes which are read with a dynamic component index
+// must be reflected as reading all components
+@vs vs
+layout(binding=0) uniform vs_params {
+    int comp;
+};
+
+in vec4 position;
+in vec4 weights;
+in vec2 texcoord0;
+
+out vec2 uv;
+out float weight;
+
+void main() {
+    gl_Position = vec4(position.xy, 0.0, 1.0);
+    weight = weights[comp];
+    uv = texcoord0;
+}
+@end
+
+@fs fs
+in vec2 uv;
+in float weight;
+out vec4 frag_color;
+
+void main() {
+    frag_color = vec4(uv, weight, 1.0);
+}
+@end
+
+@program dynamic_attr_index vs fs
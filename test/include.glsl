@@ -0,0 +1,13 @@
+// test @include, also compiled from a shader source pack with --pack
+@include include/triangle_vs.glsl
+
+@fs fs
+@include include/color_in.glsl
+out vec4 frag_color;
+
+void main() {
+    frag_color = color;
+}
+@end
+
+@program triangle vs fs
@@ -0,0 +1 @@
+in vec4 color;
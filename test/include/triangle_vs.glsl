@@ -0,0 +1,11 @@
+@vs vs
+in vec4 position;
+in vec4 color0;
+
+out vec4 color;
+
+void main() {
+    gl_Position = position;
+    color = color0;
+}
+@end
@@ -0,0 +1,49 @@
+// specialized programs via valued @program defines
+@vs vs
+uniform vs_params {
+    mat4 mvp;
+};
+in vec4 position;
+in vec3 normal;
+out vec3 nrm;
+void main() {
+    gl_Position = mvp * position;
+    nrm = normal;
+}
+@end
+
+@fs fs
+#ifndef MAX_LIGHTS
+#define MAX_LIGHTS (8)
+#endif
+uniform fs_params {
+    vec4 light_dir[8];
+    vec4 light_color[8];
+};
+in vec3 nrm;
+out vec4 frag_color;
+void main() {
+    vec3 c = vec3(0.0);
+    for (int i = 0; i < MAX_LIGHTS; i++) {
+        c += light_color[i].xyz * max(dot(nrm, light_dir[i].xyz), 0.0);
+    }
+    frag_color = vec4(c, 1.0);
+}
+@end
+
+// only used through a specialized program, fs_tint itself isn't compiled
+@fs fs_tint
+#ifndef TINT
+#define TINT (1.0)
+#endif
+in vec3 nrm;
+out vec4 frag_color;
+void main() {
+    frag_color = vec4(nrm * TINT, 1.0);
+}
+@end
+
+@program generic vs fs
+@program lights_1 vs fs MAX_LIGHTS=1
+@program lights_4 vs fs MAX_LIGHTS=4
+@program tint_half vs fs_tint TINT=0.5